@@ -2,7 +2,10 @@
 #define SRC_DATALOG_H_
 
 #include <set>
+#include <map>
+#include <vector>
 #include <unordered_set>
+#include <unordered_map>
 #include <numeric>
 #include <optional>
 #include <limits>
@@ -10,10 +13,22 @@
 #include <cassert>
 #include <iostream>
 #include <tuple>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <memory_resource>
 
 #include "tuple_hash.h"
+#include "symbol_table.h"
 #include "variable.h"
-#include "tuple_binding.h"
+#include "frame.h"
+#include "flat_set.h"
+#include "columnar_set.h"
+#include "hash_set.h"
+#include "btree_set.h"
+#include "trie_set.h"
+#include "bit_matrix_set.h"
+#include "thread_pool.h"
 
 namespace datalog
 {
@@ -61,33 +76,80 @@ void deleteVar(Variable<T> *v)
 
 // TODO: all functions below here to be refactored into separate files
 
+// Argument positions of a relation are represented as a bit mask
+template <typename RELATION_TYPE>
+constexpr size_t allPositions() {
+	constexpr size_t arity = tuple_size<typename RELATION_TYPE::Ground>::value;
+	static_assert(arity < numeric_limits<size_t>::digits, "relation arity too large for position mask");
+	return (size_t{1} << arity) - 1;
+}
+
+// Rules bind their variables in frames rather than in the variables themselves. The variables of a
+// rule are given slots in a FrameLayout when the rule is built, and each atom of the rule keeps the
+// slot of each of its arguments (FrameLayout::none for constants).
+template <typename ATOM_TYPE>
+using Slots = array<size_t, tuple_size<ATOM_TYPE>::value>;
+
+template <typename T>
+size_t slotOf(FrameLayout &, const T &)
+{
+	return FrameLayout::none;
+}
+
+template <typename T>
+size_t slotOf(FrameLayout &layout, Variable<T> *const v)
+{
+	return layout.add<T>(v);
+}
+
+// the slots of the arguments of an atom, adding its variables to a layout
+template <typename ... Ts>
+Slots<tuple<Ts...>> slotsOf(FrameLayout &layout, const tuple<Ts...> &atom)
+{
+	return apply([&layout](const auto &... args) { return Slots<tuple<Ts...>>{{slotOf(layout, args)...}}; }, atom);
+}
+
 template <typename T>
-bool bind(const T &a, const T &b)
+bool bind(const T &a, const T &b, Frame &, size_t)
 {
     return a == b;
 }
 
 template <typename T>
-bool bind(const T &a, Variable<T> *const b)
+bool bind(const T &a, Variable<T> *const, Frame &frame, size_t slot)
 {
-    if (b->isBound())
-    {
-        return b->value() == a;
-    }
-    b->bind(a);
-    return true;
+	auto &value = frame.slot<T>(slot);
+	if (value) {
+		return *value == a;
+	}
+	value.emplace(a);
+	return true;
 }
 
 template <typename GROUND_TYPE, typename ... Ts, size_t... Is>
-bool bind(const GROUND_TYPE &fact, const tuple<Ts...> &atom, index_sequence<Is...>)
+bool bind(const GROUND_TYPE &fact, const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, Frame &frame, index_sequence<Is...>)
 {
-	return ((bind(get<Is>(fact), get<Is>(atom))) and ...);
+	return ((bind(get<Is>(fact), get<Is>(atom), frame, slots[Is])) and ...);
 }
 
+// bind the variables of an atom in a frame to the arguments of a fact, false if the fact does not match
 template <typename GROUND_TYPE, typename ... Ts>
-bool bind(const GROUND_TYPE &fact, const tuple<Ts...> &atom)
+bool bind(const GROUND_TYPE &fact, const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, Frame &frame)
+{
+	return bind(fact, atom, slots, frame, make_index_sequence<tuple_size<GROUND_TYPE>::value>{});
+}
+
+template <typename T>
+void ground(const Variable<T>*, T &v, const Frame &frame, size_t slot)
+{
+	// N.B. bad optional access is thrown if the variable isn't bound
+	v = frame.slot<T>(slot).value();
+}
+
+template <typename T>
+void ground(const T &s, T &v, const Frame &, size_t)
 {
-	return bind(fact, atom, make_index_sequence<tuple_size<GROUND_TYPE>::value>{});
+	v = s;
 }
 
 template <typename T>
@@ -117,6 +179,98 @@ typename RELATION_TYPE::Ground ground(const tuple<Ts...> &atom)
 	return groundAtom;
 }
 
+template <typename T>
+bool isBound(const T &, const Frame &, size_t)
+{
+	return true;
+}
+
+template <typename T>
+bool isBound(Variable<T> *const, const Frame &frame, size_t slot)
+{
+	return frame.slot<T>(slot).has_value();
+}
+
+template <typename T>
+void unbind(const T &, Frame &, size_t)
+{
+}
+
+template <typename T>
+void unbind(Variable<T> *const, Frame &frame, size_t slot)
+{
+	frame.slot<T>(slot).reset();
+}
+
+// is an atom argument of type T a variable?
+template <typename T>
+struct isVariable : false_type {};
+
+template <typename T>
+struct isVariable<Variable<T> *> : true_type {};
+
+// the variable of an atom argument, or nullptr for a constant
+template <typename T>
+const void *variableOf(const T &)
+{
+	return nullptr;
+}
+
+template <typename T>
+const void *variableOf(Variable<T> *const v)
+{
+	return v;
+}
+
+template <typename ... Ts, size_t... Is>
+size_t boundPositions(const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, const Frame &frame, index_sequence<Is...>)
+{
+	return ((isBound(get<Is>(atom), frame, slots[Is]) ? size_t{1} << Is : size_t{0}) | ... | size_t{0});
+}
+
+// argument positions of an atom that are constants or variables bound in a frame
+template <typename ... Ts>
+size_t boundPositions(const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, const Frame &frame)
+{
+	return boundPositions(atom, slots, frame, make_index_sequence<sizeof...(Ts)>{});
+}
+
+template <typename RELATION_TYPE, typename ... Ts, size_t... Is>
+typename RELATION_TYPE::Ground ground(const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, const Frame &frame, size_t positions,
+	index_sequence<Is...>)
+{
+	typename RELATION_TYPE::Ground groundAtom{};
+	((positions & (size_t{1} << Is) ? ground(get<Is>(atom), get<Is>(groundAtom), frame, slots[Is]) : void()), ...);
+	return groundAtom;
+}
+
+// ground only the given argument positions of an atom (other positions are value-initialised)
+template <typename RELATION_TYPE, typename ... Ts>
+typename RELATION_TYPE::Ground ground(const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, const Frame &frame, size_t positions)
+{
+	return ground<RELATION_TYPE>(atom, slots, frame, positions, make_index_sequence<sizeof...(Ts)>{});
+}
+
+// ground an atom whose variables are bound in a frame
+template <typename RELATION_TYPE, typename ... Ts>
+typename RELATION_TYPE::Ground ground(const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, const Frame &frame)
+{
+	return ground<RELATION_TYPE>(atom, slots, frame, allPositions<RELATION_TYPE>());
+}
+
+template <typename ... Ts, size_t... Is>
+void unbind(const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, Frame &frame, size_t positions, index_sequence<Is...>)
+{
+	((positions & (size_t{1} << Is) ? unbind(get<Is>(atom), frame, slots[Is]) : void()), ...);
+}
+
+// unbind the variables at the given argument positions of an atom
+template <typename ... Ts>
+void unbind(const tuple<Ts...> &atom, const Slots<tuple<Ts...>> &slots, Frame &frame, size_t positions)
+{
+	unbind(atom, slots, frame, positions, make_index_sequence<sizeof...(Ts)>{});
+}
+
 template<typename RELATION_TYPE, typename ... Ts>
 struct AtomTypeSpecifier {
 	typedef RELATION_TYPE RelationType;
@@ -134,44 +288,256 @@ AtomTypeSpecifier<RELATION_TYPE, Us...> atom(Us&&... args) {
 	return AtomTypeSpecifier<RELATION_TYPE, Us...>{atomImpl(args...)};
 }
 
+// three-way comparison of the first length arguments of two tuples
+template <typename... Ts, size_t... Is>
+int comparePrefix(const tuple<Ts...> &a, const tuple<Ts...> &b, size_t length, index_sequence<Is...>)
+{
+	int c = 0;
+	((c == 0 and Is < length ? (c = get<Is>(a) < get<Is>(b) ? -1 : (get<Is>(b) < get<Is>(a) ? 1 : 0)) : c), ...);
+	return c;
+}
+
 template <typename... Ts>
-struct Relation                                                                                                        
+int comparePrefix(const tuple<Ts...> &a, const tuple<Ts...> &b, size_t length)
+{
+	return comparePrefix(a, b, length, make_index_sequence<sizeof...(Ts)>{});
+}
+
+// Storage policies choose the set that holds the tracked facts of a relation. Each is given the
+// relation and the types of its arguments, and says whether the set keeps facts in lexicographic
+// order (and so supports equal_range on a Prefix).
+
+// A B+ tree with wide nodes: range scans on prefixes of the arguments, and inserts that may run
+// concurrently
+struct BTreeStorage
+{
+	static constexpr bool ordered = true;
+	template <typename RELATION_TYPE, typename... Ts>
+	using TrackedSet = BTreeSet<typename RELATION_TYPE::Ground, less<>>;
+};
+
+// A red-black tree (std::set)
+struct TreeStorage
+{
+	static constexpr bool ordered = true;
+	template <typename RELATION_TYPE, typename... Ts>
+	using TrackedSet = set<typename RELATION_TYPE::Ground, less<>>;
+};
+
+// An open-addressing hash table, for relations that are mostly probed for whole facts. Selections
+// on such relations always use secondary indices.
+struct HashStorage
+{
+	static constexpr bool ordered = false;
+	template <typename RELATION_TYPE, typename... Ts>
+	using TrackedSet = HashSet<typename RELATION_TYPE::Ground>;
+};
+
+// A contiguous sorted vector. Facts derived in an iteration are sorted and merged in bulk.
+struct FlatStorage
+{
+	static constexpr bool ordered = true;
+	template <typename RELATION_TYPE, typename... Ts>
+	using TrackedSet = FlatSet<typename RELATION_TYPE::Ground, less<>>;
+};
+
+// One array per argument, so that selections scan only the columns they constrain. Facts derived
+// in an iteration are sorted and merged in bulk.
+struct ColumnarStorage
+{
+	static constexpr bool ordered = true;
+	template <typename RELATION_TYPE, typename... Ts>
+	using TrackedSet = ColumnarSet<Ts...>;
+};
+
+// A trie with one level per argument, which stores shared prefixes of facts once. Facts derived in
+// an iteration are sorted and the trie rebuilt in bulk.
+struct TrieStorage
 {
+	static constexpr bool ordered = true;
+	template <typename RELATION_TYPE, typename... Ts>
+	using TrackedSet = TrieSet<Ts...>;
+};
+
+// A dense bit matrix, for relations whose arguments are integers or enums below DOMAIN_SIZE. Unions
+// and differences of facts, and rules that compose such relations, work 64 facts at a time.
+template <size_t DOMAIN_SIZE>
+struct BitMatrixStorage
+{
+	static constexpr bool ordered = true;
+	template <typename RELATION_TYPE, typename... Ts>
+	using TrackedSet = BitMatrixSet<DOMAIN_SIZE, Ts...>;
+};
+
+template <typename STORAGE, typename... Ts>
+struct StoredRelation
+{
+	typedef STORAGE Storage;
 	typedef tuple<Ts...> Ground;
-#if 1
-	// set seems faster than unordered_set
+	// facts outside of evaluation are always kept in order
 	typedef set<Ground> Set;
-#else
-	typedef unordered_set<Ground> Set;
-#endif
 
-	// XXXX
-	// TODO: unordered_set implementation does not ignore tracking number
-	// FIXME
+	// the first length arguments of key, for range scans of a TrackedSet: a fact is less than a
+	// prefix if its first length arguments are, so less<> finds the facts that start with it
+	struct Prefix {
+		const Ground &key;
+		size_t length;
 
-	typedef pair<size_t, Ground> TrackedGround;
-#if 1
-	struct compare {
-		bool operator() (const TrackedGround& lhs, const TrackedGround& rhs) const {
-			// ignore tracking number
-			return lhs.second < rhs.second;
+		friend bool operator<(const Ground &fact, const Prefix &prefix) {
+			return comparePrefix(fact, prefix.key, prefix.length) < 0;
 		}
-	};
 
-	typedef set<TrackedGround, compare> TrackedSet;
-#else
-	// unordered set seems faster than set
-	struct key_hash : public std::unary_function<TrackedGround, std::size_t>
-	{
-		size_t operator()(const TrackedGround& k) const
-		{
-			hash<decltype(k.second)> h;
-			return k.first ^ h.operator()(k.second);
+		friend bool operator<(const Prefix &prefix, const Ground &fact) {
+			return comparePrefix(prefix.key, fact, prefix.length) < 0;
+		}
+
+		// the fact that gives the first argument of the prefix, if it has one (for BTreeSet searches)
+		const Ground *leading() const {
+			return length ? &key : nullptr;
 		}
 	};
-	typedef unordered_set<TrackedGround, key_hash> TrackedSet;
-#endif
 
+	typedef typename STORAGE::template TrackedSet<StoredRelation, Ts...> TrackedSet;
+};
+
+template <typename... Ts>
+struct Relation : StoredRelation<BTreeStorage, Ts...> {};
+
+template <typename... Ts>
+struct TreeRelation : StoredRelation<TreeStorage, Ts...> {};
+
+template <typename... Ts>
+struct FlatRelation : StoredRelation<FlatStorage, Ts...> {};
+
+template <typename... Ts>
+struct HashRelation : StoredRelation<HashStorage, Ts...> {};
+
+template <typename... Ts>
+struct ColumnarRelation : StoredRelation<ColumnarStorage, Ts...> {};
+
+template <typename... Ts>
+struct TrieRelation : StoredRelation<TrieStorage, Ts...> {};
+
+template <size_t DOMAIN_SIZE, typename... Ts>
+struct BitMatrixRelation : StoredRelation<BitMatrixStorage<DOMAIN_SIZE>, Ts...> {};
+
+template <typename SET_TYPE>
+struct isColumnarSet : false_type {};
+
+template <typename... Ts>
+struct isColumnarSet<ColumnarSet<Ts...>> : true_type {};
+
+template <typename SET_TYPE>
+struct isBitMatrixSet : false_type {};
+
+template <size_t DOMAIN_SIZE, typename... Ts>
+struct isBitMatrixSet<BitMatrixSet<DOMAIN_SIZE, Ts...>> : true_type {};
+
+// may several threads insert into a set at once? (only BTreeSet, of plain values)
+template <typename SET_TYPE, typename = void>
+struct hasConcurrentInserts : false_type {};
+
+template <typename SET_TYPE>
+struct hasConcurrentInserts<SET_TYPE, void_t<decltype(SET_TYPE::concurrentInserts)>> : bool_constant<SET_TYPE::concurrentInserts> {};
+
+// Make the facts inserted into a set visible: only FlatSet, ColumnarSet and TrieSet batch their inserts
+template <typename SET_TYPE>
+void flush(SET_TYPE &)
+{
+}
+
+template <typename T, typename COMPARE>
+void flush(FlatSet<T, COMPARE> &set)
+{
+	set.flush();
+}
+
+template <typename... Ts>
+void flush(ColumnarSet<Ts...> &set)
+{
+	set.flush();
+}
+
+template <typename... Ts>
+void flush(TrieSet<Ts...> &set)
+{
+	set.flush();
+}
+
+// Remove the facts of a set that are also in another set
+template <typename SET_TYPE>
+void subtract(SET_TYPE &set, const SET_TYPE &other)
+{
+	for (auto it = set.begin(); it != set.end();) {
+		if (other.find(*it) != other.end()) {
+			it = set.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+template <typename T, typename COMPARE>
+void subtract(FlatSet<T, COMPARE> &set, const FlatSet<T, COMPARE> &other)
+{
+	set.subtract(other);
+}
+
+template <typename T, typename COMPARE, size_t NODE_BYTES>
+void subtract(BTreeSet<T, COMPARE, NODE_BYTES> &set, const BTreeSet<T, COMPARE, NODE_BYTES> &other)
+{
+	set.subtract(other);
+}
+
+template <typename... Ts>
+void subtract(ColumnarSet<Ts...> &set, const ColumnarSet<Ts...> &other)
+{
+	set.subtract(other);
+}
+
+template <typename... Ts>
+void subtract(TrieSet<Ts...> &set, const TrieSet<Ts...> &other)
+{
+	set.subtract(other);
+}
+
+template <size_t DOMAIN_SIZE, typename... Ts>
+void subtract(BitMatrixSet<DOMAIN_SIZE, Ts...> &set, const BitMatrixSet<DOMAIN_SIZE, Ts...> &other)
+{
+	set.subtract(other);
+}
+
+// Move the facts of another set that are not in a set into it, and remove the facts of a set that
+// are in another set, with the help of a pool: only BTreeSet splits large sets between tasks
+template <typename SET_TYPE>
+void mergeSet(SET_TYPE &set, SET_TYPE &other, ThreadPool &)
+{
+	set.merge(other);
+}
+
+template <typename T, typename COMPARE, size_t NODE_BYTES>
+void mergeSet(BTreeSet<T, COMPARE, NODE_BYTES> &set, BTreeSet<T, COMPARE, NODE_BYTES> &other, ThreadPool &pool)
+{
+	set.merge(other, pool);
+}
+
+template <typename SET_TYPE>
+void subtract(SET_TYPE &set, const SET_TYPE &other, ThreadPool &)
+{
+	subtract(set, other);
+}
+
+template <typename T, typename COMPARE, size_t NODE_BYTES>
+void subtract(BTreeSet<T, COMPARE, NODE_BYTES> &set, const BTreeSet<T, COMPARE, NODE_BYTES> &other, ThreadPool &pool)
+{
+	set.subtract(other, pool);
+}
+
+// Partitions of the facts of a relation in semi-naive evaluation
+enum Partition {
+	Stable = 1, // facts known before the current iteration
+	Delta = 2, // facts first derived in the previous iteration
+	Full = Stable | Delta
 };
 
 template <typename HEAD_RELATION, typename... BODY_RELATIONs>
@@ -179,8 +545,9 @@ struct Rule
 {
 	typedef HEAD_RELATION HeadRelationType;
 	typedef tuple<BODY_RELATIONs...> BodyRelations;
-	typedef tuple<typename BODY_RELATIONs::TrackedSet::const_iterator...> BodyRelationsIteratorType;
-	typedef tuple<const typename BODY_RELATIONs::TrackedGround *...> SliceType;
+	typedef tuple<typename BODY_RELATIONs::TrackedSet::const_iterator...> SliceType;
+	typedef array<Partition, sizeof...(BODY_RELATIONs)> BodyPartitionsType;
+	typedef tuple<vector<typename BODY_RELATIONs::TrackedSet::const_iterator>...> BodyViewsType;
 };
 
 template<typename ... EXTERNAL_TYPEs>
@@ -194,6 +561,24 @@ struct BodyAtoms {
 	tuple<typename BODY_ATOM_SPECIFIERs::AtomType...> body;
 };
 
+template <typename BODY_TYPE>
+struct BodySlots;
+
+template <typename ... ATOM_TYPEs>
+struct BodySlots<tuple<ATOM_TYPEs...>> {
+	typedef tuple<Slots<ATOM_TYPEs>...> type;
+};
+
+// The frame layout of a rule, with the slots of the arguments of its atoms and of the variables
+// bound by its externals
+template <typename HEAD_TYPE, typename BODY_TYPE, size_t EXTERNALS = 0>
+struct RuleLayout {
+	FrameLayout frame;
+	Slots<HEAD_TYPE> head;
+	typename BodySlots<BODY_TYPE>::type body;
+	array<size_t, EXTERNALS> externals;
+};
+
 template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
 struct RuleInstance {
 	typedef Rule<typename HEAD_ATOM_SPECIFIER::RelationType, typename BODY_ATOM_SPECIFIERs::RelationType...> RuleType;
@@ -201,6 +586,7 @@ struct RuleInstance {
 	const HeadType head;
 	typedef tuple<typename BODY_ATOM_SPECIFIERs::AtomType...> BodyType;
 	BodyType body;
+	RuleLayout<HeadType, BodyType> layout{};
 };
 
 template <typename EXTERNALS_TYPE, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
@@ -211,27 +597,184 @@ struct ExternalRuleInstance {
 	typedef tuple<typename BODY_ATOM_SPECIFIERs::AtomType...> BodyType;
 	BodyType body;
 	const EXTERNALS_TYPE externals;
+	RuleLayout<HeadType, BodyType, tuple_size<typename EXTERNALS_TYPE::ExternalsTupleType>::value> layout{};
+};
+
+// Rules over placeholders
+
+// the index of an atom argument that is a placeholder, or noPlaceholder for a constant or variable
+constexpr size_t noPlaceholder = numeric_limits<size_t>::max();
+
+template <typename T>
+struct placeholderIndex : integral_constant<size_t, noPlaceholder> {};
+
+template <size_t N>
+struct placeholderIndex<Placeholder<N>> : integral_constant<size_t, N> {};
+
+template <typename ATOM_TYPE>
+struct hasPlaceholders;
+
+template <typename ... Ts>
+struct hasPlaceholders<tuple<Ts...>> : bool_constant<((placeholderIndex<typename decay<Ts>::type>::value != noPlaceholder) or ...)> {};
+
+template <typename ATOM_TYPE>
+struct hasVariables;
+
+template <typename ... Ts>
+struct hasVariables<tuple<Ts...>> : bool_constant<(isVariable<typename decay<Ts>::type>::value or ...)> {};
+
+// The join of a rule whose variables are placeholders, planned at compile time. The atoms of the body
+// are joined in the order they are written, and each argument of an atom is either a constant, a
+// placeholder that first occurs earlier (whose value is read from the fact that it first occurs
+// in), or a placeholder that first occurs there.
+template <typename HEAD_TYPE, typename BODY_TYPE>
+struct StaticJoinPlan;
+
+template <typename HEAD_TYPE, typename ... ATOM_TYPEs>
+struct StaticJoinPlan<HEAD_TYPE, tuple<ATOM_TYPEs...>> {
+	static constexpr size_t bodySize = sizeof...(ATOM_TYPEs);
+	static constexpr size_t maxArity = max({tuple_size<HEAD_TYPE>::value, tuple_size<ATOM_TYPEs>::value...});
+	typedef array<size_t, maxArity> ArgumentsType;
+
+	// the atom and argument position where a placeholder first occurs in the body
+	struct Source {
+		size_t atom;
+		size_t position;
+	};
+
+	template <typename ... Ts>
+	static constexpr ArgumentsType placeholders(const tuple<Ts...> *) {
+		ArgumentsType indices{};
+		const size_t atomIndices[] = {placeholderIndex<typename decay<Ts>::type>::value..., noPlaceholder};
+		for (size_t i = 0; i < maxArity; i++) {
+			indices[i] = i < sizeof...(Ts) ? atomIndices[i] : noPlaceholder;
+		}
+		return indices;
+	}
+
+	// the placeholder at each argument position of the head and of each atom of the body
+	static constexpr ArgumentsType head = placeholders(static_cast<const HEAD_TYPE *>(nullptr));
+	static constexpr array<ArgumentsType, bodySize> body{{placeholders(static_cast<const ATOM_TYPEs *>(nullptr))...}};
+	static constexpr array<size_t, bodySize> arities{{tuple_size<ATOM_TYPEs>::value...}};
+
+	static constexpr Source source(size_t placeholder) {
+		for (size_t i = 0; i < bodySize; i++) {
+			for (size_t c = 0; c < arities[i]; c++) {
+				if (body[i][c] == placeholder) {
+					return {i, c};
+				}
+			}
+		}
+		return {bodySize, 0};
+	}
+
+	// the argument positions of an atom that are constants or placeholders of earlier atoms, which
+	// make up the key that its facts are looked up on
+	static constexpr size_t boundPositions(size_t atom) {
+		size_t positions = 0;
+		for (size_t c = 0; c < arities[atom]; c++) {
+			if (body[atom][c] == noPlaceholder or source(body[atom][c]).atom < atom) {
+				positions |= size_t{1} << c;
+			}
+		}
+		return positions;
+	}
+
+	// the argument positions of an atom that repeat a placeholder of an earlier position of the atom,
+	// which its facts are checked on
+	static constexpr size_t repeatedPositions(size_t atom) {
+		size_t positions = 0;
+		for (size_t c = 0; c < arities[atom]; c++) {
+			if (body[atom][c] != noPlaceholder and source(body[atom][c]).atom == atom and source(body[atom][c]).position < c) {
+				positions |= size_t{1} << c;
+			}
+		}
+		return positions;
+	}
+
+	// is every placeholder of the head in the body?
+	static constexpr bool rangeRestricted() {
+		for (size_t c = 0; c < tuple_size<HEAD_TYPE>::value; c++) {
+			if (head[c] != noPlaceholder and source(head[c]).atom == bodySize) {
+				return false;
+			}
+		}
+		return true;
+	}
 };
 
+// A rule whose variables are placeholders. It has no frame layout: its join is planned when it is
+// compiled, and evaluating it reads the values of placeholders from the facts that match them.
 template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...> rule(
+struct StaticRuleInstance {
+	typedef Rule<typename HEAD_ATOM_SPECIFIER::RelationType, typename BODY_ATOM_SPECIFIERs::RelationType...> RuleType;
+	typedef typename HEAD_ATOM_SPECIFIER::AtomType HeadType;
+	const HeadType head;
+	typedef tuple<typename BODY_ATOM_SPECIFIERs::AtomType...> BodyType;
+	BodyType body;
+	typedef StaticJoinPlan<HeadType, BodyType> PlanType;
+	static_assert(not (hasVariables<HeadType>::value or ... or hasVariables<typename BODY_ATOM_SPECIFIERs::AtomType>::value),
+		"a rule with placeholders cannot also have variables");
+	static_assert(PlanType::rangeRestricted(), "every placeholder of the head of a rule must occur in its body");
+};
+
+template <typename RULE_TYPE, typename = void>
+struct isStaticRule : false_type {};
+
+template <typename RULE_TYPE>
+struct isStaticRule<RULE_TYPE, void_t<typename RULE_TYPE::PlanType>> : true_type {};
+
+// the instance of a rule: static if any of its atoms has placeholders
+template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
+using RuleInstanceFor = typename conditional<
+	(hasPlaceholders<typename HEAD_ATOM_SPECIFIER::AtomType>::value or ... or hasPlaceholders<typename BODY_ATOM_SPECIFIERs::AtomType>::value),
+	StaticRuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>,
+	RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>>::type;
+
+// Give the variables of a rule their slots: those of the body in order of occurrence, then those
+// bound by externals, then any others of the head
+template <typename RULE_INSTANCE_TYPE>
+RULE_INSTANCE_TYPE layOut(RULE_INSTANCE_TYPE &&rule)
+{
+	auto &layout = rule.layout;
+	layout.body = apply([&layout](const auto &... atoms) {
+		return typename BodySlots<typename RULE_INSTANCE_TYPE::BodyType>::type{slotsOf(layout.frame, atoms)...};
+	}, rule.body);
+	if constexpr (tuple_size<decltype(layout.externals)>::value > 0) {
+		layout.externals = apply([&layout](const auto &... externals) {
+			return decltype(layout.externals){{slotOf(layout.frame, externals.bindVariable)...}};
+		}, rule.externals.externals);
+	}
+	layout.head = slotsOf(layout.frame, rule.head);
+	return move(rule);
+}
+
+template <typename RULE_INSTANCE_TYPE>
+RULE_INSTANCE_TYPE makeRule(const typename RULE_INSTANCE_TYPE::HeadType &head, const typename RULE_INSTANCE_TYPE::BodyType &body)
+{
+	if constexpr (isStaticRule<RULE_INSTANCE_TYPE>::value) {
+		return RULE_INSTANCE_TYPE{head, body};
+	} else {
+		return layOut(RULE_INSTANCE_TYPE{head, body});
+	}
+}
+
+template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
+auto rule(
 	const HEAD_ATOM_SPECIFIER& h,
 	const BODY_ATOM_SPECIFIERs&... b
 ) {
-	typedef RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...> RuleInstanceType;
-	typename RuleInstanceType::HeadType head{h.atom};
-	typename RuleInstanceType::BodyType body{b.atom...};
-	return RuleInstanceType{head, body};
+	typedef RuleInstanceFor<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...> RuleInstanceType;
+	return makeRule<RuleInstanceType>(typename RuleInstanceType::HeadType{h.atom}, typename RuleInstanceType::BodyType{b.atom...});
 }
 
 template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...> rule(
+auto rule(
 	const HEAD_ATOM_SPECIFIER& h,
 	const BodyAtoms<BODY_ATOM_SPECIFIERs...>& b
 ) {
-	typedef RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...> RuleInstanceType;
-	typename RuleInstanceType::HeadType head{h.atom};
-	return RuleInstanceType{head, b.body};
+	typedef RuleInstanceFor<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...> RuleInstanceType;
+	return makeRule<RuleInstanceType>(typename RuleInstanceType::HeadType{h.atom}, b.body);
 }
 
 // Rules with external functions
@@ -262,8 +805,10 @@ ExternalRuleInstance<Externals<EXTERNAL_TYPEs...>, HEAD_ATOM_SPECIFIER, BODY_ATO
 	const EXTERNAL_TYPEs&... externals
 ) {
 	typedef ExternalRuleInstance<Externals<EXTERNAL_TYPEs...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...> RuleInstanceType;
+	static_assert(not isStaticRule<RuleInstanceFor<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>>::value,
+		"external functions bind variables, so a rule with externals cannot have placeholders");
 	typename RuleInstanceType::HeadType head{h.atom};
-	return RuleInstanceType{head, b.body, Externals<EXTERNAL_TYPEs...>{{externals...}}};
+	return layOut(RuleInstanceType{head, b.body, Externals<EXTERNAL_TYPEs...>{{externals...}}});
 }
 
 template <typename RELATION_TYPE>
@@ -295,22 +840,190 @@ ostream & operator<<(ostream &out, const RelationSet<RELATION_TYPE>& relationSet
 {
 	out << "\"" << typeid(relationSet).name() << "\"" << endl;
 	for (const auto& tuple : relationSet.set) {
-		datalog::operator<< <RELATION_TYPE>(out, tuple.second);
+		datalog::operator<< <RELATION_TYPE>(out, tuple);
 		out << endl;
 	}
 	return out;
 }
 
+// A read-only view of the facts of a relation in a state, which reads its tracked set in place
+// rather than copying it into a Set. The view is valid while the state is unchanged.
 template<typename RELATION_TYPE>
-struct RelationSize {
-	size_t size = numeric_limits<size_t>::max();
-};
+struct RelationView {
+	typedef typename RELATION_TYPE::Ground Ground;
+	typedef typename RELATION_TYPE::TrackedSet::const_iterator const_iterator;
 
-template <typename... RELATIONs>
-struct State
-{
+	const typename RELATION_TYPE::TrackedSet &set;
+
+	const_iterator begin() const {
+		return set.begin();
+	}
+
+	const_iterator end() const {
+		return set.end();
+	}
+
+	size_t size() const {
+		return set.size();
+	}
+
+	bool empty() const {
+		return set.empty();
+	}
+
+	bool contains(const Ground &fact) const {
+		return set.find(fact) != set.end();
+	}
+};
+
+template<typename RELATION_TYPE>
+struct RelationSize {
+	size_t size = numeric_limits<size_t>::max();
+};
+
+template <typename GROUND_TYPE, size_t... Is>
+GROUND_TYPE indexKey(const GROUND_TYPE &fact, size_t positions, index_sequence<Is...>)
+{
+	GROUND_TYPE key{};
+	((positions & (size_t{1} << Is) ? (void)(get<Is>(key) = get<Is>(fact)) : void()), ...);
+	return key;
+}
+
+// key of a fact in an index on the given positions (other positions are value-initialised)
+template <typename GROUND_TYPE>
+GROUND_TYPE indexKey(const GROUND_TYPE &fact, size_t positions)
+{
+	return indexKey(fact, positions, make_index_sequence<tuple_size<GROUND_TYPE>::value>{});
+}
+
+// Secondary index of a relation on a subset of its argument positions, either ordered (map) or
+// hashed (unordered_map), allocated from a memory resource
+template<typename RELATION_TYPE, template <typename...> class MAP_TYPE = pmr::map>
+struct RelationIndex {
+	typedef typename RELATION_TYPE::Ground Ground;
+	typedef typename RELATION_TYPE::TrackedSet::const_iterator FactIterator;
+	typedef pmr::vector<FactIterator> Facts;
+
+	RelationIndex(const typename RELATION_TYPE::TrackedSet& set, size_t positions, pmr::memory_resource *resource) : index(resource) {
+		for (auto it = set.begin(); it != set.end(); ++it) {
+			index[indexKey(*it, positions)].push_back(it);
+		}
+	}
+
+	const Facts* find(const Ground& key) const {
+		auto it = index.find(key);
+		return it != index.end() ? &it->second : nullptr;
+	}
+
+private:
+	MAP_TYPE<Ground, Facts> index;
+};
+
+// Indices of the partitions of a relation, built on demand and keyed on the partition and indexed
+// positions. They last one iteration, so their facts are allocated from the iteration's arena.
+template<typename RELATION_TYPE>
+struct RelationIndices {
+	typedef pair<unsigned, size_t> KeyType;
+	map<KeyType, RelationIndex<RELATION_TYPE>> indices;
+	map<KeyType, RelationIndex<RELATION_TYPE, pmr::unordered_map>> hashIndices;
+
+	explicit RelationIndices(pmr::memory_resource *resource = pmr::get_default_resource()) : resource(resource) {}
+
+	const RelationIndex<RELATION_TYPE>& index(const typename RELATION_TYPE::TrackedSet& set, unsigned partition, size_t positions) {
+		return index(indices, set, partition, positions);
+	}
+
+	const RelationIndex<RELATION_TYPE, pmr::unordered_map>& hashIndex(const typename RELATION_TYPE::TrackedSet& set, unsigned partition, size_t positions) {
+		return index(hashIndices, set, partition, positions);
+	}
+
+private:
+	template <typename INDICES_TYPE>
+	const typename INDICES_TYPE::mapped_type& index(INDICES_TYPE& indices, const typename RELATION_TYPE::TrackedSet& set, unsigned partition, size_t positions) {
+		const KeyType key{partition, positions};
+		auto it = indices.find(key);
+		if (it == indices.end()) {
+			it = indices.emplace(key, typename INDICES_TYPE::mapped_type{set, positions, resource}).first;
+		}
+		return it->second;
+	}
+
+	pmr::memory_resource *resource;
+};
+
+// number of leading argument positions
+constexpr size_t prefixLength(size_t positions)
+{
+	size_t length = 0;
+	while (positions & (size_t{1} << length)) {
+		length++;
+	}
+	return length;
+}
+
+// does forEachMatch look up the facts that match the given positions in a secondary index?
+template <typename RELATION_TYPE>
+constexpr bool matchesByIndex(size_t positions)
+{
+	if (positions == 0 or isColumnarSet<typename RELATION_TYPE::TrackedSet>::value) {
+		return false;
+	}
+	return not (RELATION_TYPE::Storage::ordered and positions == (size_t{1} << prefixLength(positions)) - 1);
+}
+
+// Visit the facts of a partition of a relation that match a key on some positions: a range
+// scan when the positions are a prefix of the arguments of an ordered set, otherwise an index lookup
+// (or column scans, for columnar relations)
+template <typename RELATION_TYPE, typename F>
+void forEachMatch(const typename RELATION_TYPE::TrackedSet &set, Partition partition, const typename RELATION_TYPE::Ground &key,
+	size_t positions, RelationIndices<RELATION_TYPE> &indices, F f)
+{
+	if (positions == 0) {
+		for (auto it = set.begin(); it != set.end(); ++it) {
+			f(it);
+		}
+		return;
+	}
+	const size_t length = prefixLength(positions);
+	if constexpr (isColumnarSet<typename RELATION_TYPE::TrackedSet>::value) {
+		// binary search the leading columns, then scan the other bound columns
+		const auto range = set.prefixRange(key, length);
+		set.forEachMatch(range.first, range.second, key, positions & ~((size_t{1} << length) - 1), f);
+	} else {
+		if constexpr (RELATION_TYPE::Storage::ordered) {
+			if (positions == (size_t{1} << length) - 1) {
+				const auto range = set.equal_range(typename RELATION_TYPE::Prefix{key, length});
+				for (auto it = range.first; it != range.second; ++it) {
+					f(it);
+				}
+				return;
+			}
+		}
+		if (const auto *facts = indices.index(set, partition, positions).find(key)) {
+			for (const auto &it : *facts) {
+				f(it);
+			}
+		}
+	}
+}
+
+template <typename RELATION_TYPE>
+static typename RELATION_TYPE::Set convert(const typename RELATION_TYPE::TrackedSet& trackedSet) {
+	typename RELATION_TYPE::Set set;
+	for (const auto& relation : trackedSet) {
+		set.insert(relation);
+	}
+	return set;
+}
+
+template <typename... RELATIONs>
+struct State
+{
 	typedef tuple<RelationSet<RELATIONs>...> StateRelationsType;
+	// the stable facts (all facts, outside of fixPoint)
 	StateRelationsType stateRelations;
+	// the facts first derived in the previous iteration of fixPoint (disjoint from the stable facts)
+	StateRelationsType deltaRelations;
 
 	State() {}
 
@@ -318,30 +1031,50 @@ struct State
 	State(const typename RELATIONs::Set&... stateRelations) : stateRelations(convert(stateRelations...)) {
 	}
 
+	// a copy of the facts of a relation (view reads them without copying)
 	template <typename RELATION_TYPE>
 	const typename RELATION_TYPE::Set getSet() const {
-		return convert<RELATION_TYPE>(getTrackedSet<RELATION_TYPE>());
+		return datalog::convert<RELATION_TYPE>(getTrackedSet<RELATION_TYPE>());
 	}
 
 	template <typename RELATION_TYPE>
-	const typename RELATION_TYPE::TrackedSet getTrackedSet() const {
+	const typename RELATION_TYPE::TrackedSet& getTrackedSet() const {
 		return get<RelationSet<RELATION_TYPE>>(stateRelations).set;
 	}
 
+	template <typename RELATION_TYPE>
+	RelationView<RELATION_TYPE> view() const {
+		return {getTrackedSet<RELATION_TYPE>()};
+	}
+
+	template <typename RELATION_TYPE>
+	const typename RELATION_TYPE::TrackedSet& partition(Partition p) const {
+		return get<RelationSet<RELATION_TYPE>>(p == Delta ? deltaRelations : stateRelations).set;
+	}
+
+	template <typename RELATION_TYPE>
+	size_t size(unsigned partitions) const {
+		return (partitions & Stable ? partition<RELATION_TYPE>(Stable).size() : 0) +
+			(partitions & Delta ? partition<RELATION_TYPE>(Delta).size() : 0);
+	}
+
 	typedef tuple<RelationSize<RELATIONs>...> StateSizesType;
 
+	typedef tuple<RelationIndices<RELATIONs>...> IndicesType;
+
 	template<size_t I>
-	void sizes(StateSizesType& s) const {
-		get<I>(s).size = get<I>(stateRelations).set.size();
+	void sizes(StateSizesType& s, unsigned partitions) const {
+		typedef typename tuple_element<I, RelationsType>::type RelationType;
+		get<I>(s).size = size<RelationType>(partitions);
 	}
 
 	template<size_t ... Is>
-	void sizes(StateSizesType& s, index_sequence<Is...>) const {
-		((sizes<Is>(s)), ...);
+	void sizes(StateSizesType& s, unsigned partitions, index_sequence<Is...>) const {
+		((sizes<Is>(s, partitions)), ...);
 	}
 
-	void sizes(StateSizesType& s) const {
-		sizes(s, make_index_sequence<tuple_size<StateSizesType>::value>{});
+	void sizes(StateSizesType& s, unsigned partitions = Full) const {
+		sizes(s, partitions, make_index_sequence<tuple_size<StateSizesType>::value>{});
 	}
 
 	static size_t size(const StateSizesType& s) {
@@ -365,77 +1098,37 @@ struct State
 		diff(a, b, make_index_sequence<tuple_size<StateSizesType>::value>{});
 	}
 
+	// Iterates over every combination of facts from views of the facts of each body atom
 	template<typename RULE_TYPE>
 	struct Iterator
 	{
 		typedef typename RULE_TYPE::SliceType SliceType;
-		typedef typename RULE_TYPE::BodyRelationsIteratorType RelationsIteratorType;
-		
-		Iterator(const StateRelationsType &relations) : relations(relations), iterators(initIterators(relations))
-		{
-		}
+		typedef typename RULE_TYPE::BodyViewsType ViewsType;
+		static constexpr size_t N = tuple_size<ViewsType>::value;
 
-	private:
-		template <size_t I>
-		void pick(const StateRelationsType &relations, SliceType &slice)
+		Iterator(const ViewsType &views) : views(views)
 		{
-			typedef typename tuple_element<I, typename RULE_TYPE::BodyRelations>::type RelationType;
-			const auto &it = get<I>(iterators);
-			auto& sliceElement = get<I>(slice);
-			const auto& relation = get<RelationSet<RelationType>>(relations);
-			if (it != relation.set.end())
-			{
-				// TODO: avoid cast if possible
-				sliceElement = reinterpret_cast<const typename RelationType::TrackedGround *>(&*it);
-			}
-			else
-			{
-				sliceElement = nullptr;
-			}
+			initSizes(make_index_sequence<N>{});
+			iterationFinished = any_of(sizes.begin(), sizes.end(), [](size_t size) { return size == 0; });
 		}
 
+	private:
 		template <size_t... Is>
-		void pick(const StateRelationsType &relations, SliceType &slice,
-				  index_sequence<Is...>)
+		void pick(SliceType &slice, index_sequence<Is...>) const
 		{
-			((pick<Is>(relations, slice)), ...);
+			((get<Is>(slice) = get<Is>(views)[positions[Is]]), ...);
 		}
 
-		template <size_t I>
-		bool next(const StateRelationsType &relations, RelationsIteratorType &iterators,
-				  bool &stop)
+		// advance the positions like an odometer, returning true when every combination has been visited
+		bool next(size_t i)
 		{
-			typedef typename tuple_element<I, typename RULE_TYPE::BodyRelations>::type RelationType;
-
-			bool iterationFinished = false;
-			if (not stop)
-			{
-				auto &it = get<I>(iterators);
-				const auto &end = get<RelationSet<RelationType>>(relations).set.end();
-				if (it != end)
-					it++;
-				if (it == end)
-				{
-					it = get<RelationSet<RelationType>>(relations).set.begin();
-					if (I == tuple_size<RelationsIteratorType>::value - 1)
-					{
-						iterationFinished = true;
-					}
-				}
-				else
-				{
-					stop = true;
+			for (; i < N; i++) {
+				if (++positions[i] < sizes[i]) {
+					return false;
 				}
+				positions[i] = 0;
 			}
-			return iterationFinished;
-		}
-
-		template <size_t... Is>
-		bool next(const StateRelationsType &relations, RelationsIteratorType &iterators,
-				  index_sequence<Is...>)
-		{
-			bool stop = false;
-			return ((next<Is>(relations, iterators, stop)) or ...);
+			return true;
 		}
 
 	public:
@@ -447,45 +1140,28 @@ struct State
 		SliceType next()
 		{
 			SliceType slice;
-			auto indexSequence = make_index_sequence<tuple_size<RelationsIteratorType>::value>{};
-			pick(relations, slice, indexSequence);
-			iterationFinished = next(relations, iterators, indexSequence);
+			pick(slice, make_index_sequence<N>{});
+			iterationFinished = next(0);
 			return slice;
 		}
 
 	private:
-		const StateRelationsType &relations;
-		RelationsIteratorType iterators;
-		bool iterationFinished = false;
-
-		template <size_t I>
-		static void initIterator(const StateRelationsType &relations, RelationsIteratorType &iterators)
-		{
-			typedef typename tuple_element<I, typename RULE_TYPE::BodyRelations>::type RelationType;
-			auto& it = get<I>(iterators);
-			const auto& relation = get<RelationSet<RelationType>>(relations);
-			it = relation.set.begin();
-		}
+		const ViewsType &views;
+		array<size_t, N> positions{};
+		array<size_t, N> sizes;
+		bool iterationFinished;
 
 		template <size_t... Is>
-		static void initIterators(const StateRelationsType &relations,
-								  RelationsIteratorType &iterators, index_sequence<Is...>)
-		{
-			((initIterator<Is>(relations, iterators)), ...);
-		}
-
-		static RelationsIteratorType initIterators(const StateRelationsType &relations)
+		void initSizes(index_sequence<Is...>)
 		{
-			RelationsIteratorType iterators;
-			initIterators(relations, iterators, make_index_sequence<tuple_size<RelationsIteratorType>::value>{});
-			return iterators;
+			((sizes[Is] = get<Is>(views).size()), ...);
 		}
 	};
 
 	template <typename RULE_TYPE>
-	Iterator<RULE_TYPE> it() const
+	Iterator<RULE_TYPE> it(const typename RULE_TYPE::BodyViewsType &views) const
 	{
-		Iterator<RULE_TYPE> it{stateRelations};
+		Iterator<RULE_TYPE> it{views};
 		return it;
 	}
 
@@ -497,8 +1173,9 @@ private:
 	static typename RELATION_TYPE::TrackedSet convert(const typename RELATION_TYPE::Set& set) {
 		typename RELATION_TYPE::TrackedSet trackedSet;
 		for (const auto& relation : set) {
-			trackedSet.insert({0, relation});
+			trackedSet.insert(relation);
 		}
+		flush(trackedSet);
 		return trackedSet;
 	}
 
@@ -523,15 +1200,6 @@ private:
 
 };
 
-template <typename RELATION_TYPE>
-static typename RELATION_TYPE::Set convert(const typename RELATION_TYPE::TrackedSet& trackedSet) {
-	typename RELATION_TYPE::Set set;
-	for (const auto& relation : trackedSet) {
-		set.insert(relation.second);
-	}
-	return set;
-}
-
 template <typename... RELATIONs>
 ostream & operator<<(ostream &out, const State<RELATIONs...>& state) {
 	out << "[";
@@ -540,41 +1208,27 @@ ostream & operator<<(ostream &out, const State<RELATIONs...>& state) {
 	return out;
 }
 
-template <typename RULE_INSTANCE_TYPE>
-void unbind(const typename RULE_INSTANCE_TYPE::BodyType &atoms)
-{
-	apply([](auto &&... args) { ((unbind(args)), ...); }, atoms);
-}
-
 template <size_t I, typename RULE_INSTANCE_TYPE, typename RULE_TYPE>
-bool bindBodyAtomsToSlice(const typename RULE_INSTANCE_TYPE::BodyType &atoms,
-				 const typename RULE_TYPE::SliceType &slice)
+bool bindBodyAtomsToSlice(const RULE_INSTANCE_TYPE &rule, const typename RULE_TYPE::SliceType &slice, Frame &frame)
 {
-	auto factPtr = get<I>(slice);
-	bool success = false;
-	if (factPtr)
-	{
-		const auto &fact = *factPtr;
-		// get the atom
-		auto &atom = get<I>(atoms);
-		// try to bind the atom with the fact
-		success = bind(fact.second, atom);
-	}
-	return success;
+	const auto &it = get<I>(slice);
+	// get the atom
+	auto &atom = get<I>(rule.body);
+	// try to bind the atom with the fact
+	return datalog::bind(*it, atom, get<I>(rule.layout.body), frame);
 }
 
 template <typename RULE_INSTANCE_TYPE, typename RULE_TYPE, size_t... Is>
-bool bindBodyAtomsToSlice(const typename RULE_INSTANCE_TYPE::BodyType &atoms,
-				 const typename RULE_TYPE::SliceType &slice, index_sequence<Is...>)
+bool bindBodyAtomsToSlice(const RULE_INSTANCE_TYPE &rule, const typename RULE_TYPE::SliceType &slice, Frame &frame, index_sequence<Is...>)
 {
-	return ((bindBodyAtomsToSlice<Is, RULE_INSTANCE_TYPE, RULE_TYPE>(atoms, slice)) and ...);
+	return ((bindBodyAtomsToSlice<Is, RULE_INSTANCE_TYPE, RULE_TYPE>(rule, slice, frame)) and ...);
 }
 
 template <typename RULE_INSTANCE_TYPE, typename RULE_TYPE>
-bool bindBodyAtomsToSlice(const typename RULE_INSTANCE_TYPE::BodyType &atoms, const typename RULE_TYPE::SliceType &slice)
+bool bindBodyAtomsToSlice(const RULE_INSTANCE_TYPE &rule, const typename RULE_TYPE::SliceType &slice, Frame &frame)
 {
 	// for each atom, bind with corresponding relation type in slice
-	return bindBodyAtomsToSlice<RULE_INSTANCE_TYPE, RULE_TYPE>(atoms, slice, make_index_sequence<tuple_size<typename RULE_INSTANCE_TYPE::BodyType>::value>{});
+	return bindBodyAtomsToSlice<RULE_INSTANCE_TYPE, RULE_TYPE>(rule, slice, frame, make_index_sequence<tuple_size<typename RULE_INSTANCE_TYPE::BodyType>::value>{});
 }
 
 template <typename RELATION_TYPE, size_t... Is>
@@ -597,200 +1251,1677 @@ typename RELATION_TYPE::Ground ground(const AtomTypeSpecifier<RELATION_TYPE, Ts.
 	return ground<RELATION_TYPE>(atomTypeSpecifier.atom);
 }
 
-template <size_t I, typename RULE_TYPE>
-bool unseenSlice(size_t iteration, const typename RULE_TYPE::SliceType &slice)
+// Semi-naive evaluation only considers combinations of body facts that contain a delta fact.
+// These are enumerated by the delta variants of a rule body: in variant i the atoms before i
+// range over the stable facts, atom i over the delta facts and the atoms after i over all facts.
+
+template <typename RULE_TYPE, typename STATE_TYPE, size_t... Is>
+bool emptyBody(const STATE_TYPE &state, const typename RULE_TYPE::BodyPartitionsType &partitions, index_sequence<Is...>)
 {
-	auto factPtr = get<I>(slice);
-	if (factPtr) {
-		const auto &fact = *factPtr;
-		return fact.first == iteration;	
-	}
-	return false;
+	return ((state.template size<typename tuple_element<Is, typename RULE_TYPE::BodyRelations>::type>(partitions[Is]) == 0) or ...);
 }
 
-template <typename RULE_TYPE, size_t... Is>
-bool unseenSlice(size_t iteration, const typename RULE_TYPE::SliceType &slice, index_sequence<Is...>)
+// does some atom in the body range over no facts?
+template <typename RULE_TYPE, typename STATE_TYPE>
+bool emptyBody(const STATE_TYPE &state, const typename RULE_TYPE::BodyPartitionsType &partitions)
 {
-	return ((unseenSlice<Is, RULE_TYPE>(iteration, slice)) or ...);
+	return emptyBody<RULE_TYPE>(state, partitions, make_index_sequence<tuple_size<typename RULE_TYPE::BodyRelations>::value>{});
 }
 
-template <typename RULE_TYPE>
-bool unseenSlice(size_t iteration, const typename RULE_TYPE::SliceType &slice) {
-	return unseenSlice<RULE_TYPE>(iteration, slice, make_index_sequence<tuple_size<typename RULE_TYPE::BodyRelations>::value>{});
-	return true;
+template <typename RULE_TYPE, typename STATE_TYPE, size_t... Is>
+array<size_t, sizeof...(Is)> bodySizes(const STATE_TYPE &state, const typename RULE_TYPE::BodyPartitionsType &partitions, index_sequence<Is...>)
+{
+	return {{state.template size<typename tuple_element<Is, typename RULE_TYPE::BodyRelations>::type>(partitions[Is])...}};
 }
 
-template<size_t I, typename RULE_TYPE, typename STATE_TYPE>
-bool unseenSlicePossible(const typename STATE_TYPE::StateSizesType& stateSizeDelta) {
-	typedef typename tuple_element<I, typename RULE_TYPE::BodyRelations>::type RelationType;
-	const auto& sizeDelta = get<RelationSize<RelationType>>(stateSizeDelta);
-	return sizeDelta.size > 0;
+// number of facts each atom in the body ranges over
+template <typename RULE_TYPE, typename STATE_TYPE>
+array<size_t, tuple_size<typename RULE_TYPE::BodyRelations>::value> bodySizes(const STATE_TYPE &state, const typename RULE_TYPE::BodyPartitionsType &partitions)
+{
+	return bodySizes<RULE_TYPE>(state, partitions, make_index_sequence<tuple_size<typename RULE_TYPE::BodyRelations>::value>{});
+}
+
+template <typename RULE_TYPE, typename STATE_TYPE, typename F>
+void forEachDeltaVariant(const STATE_TYPE &state, F f)
+{
+	typename RULE_TYPE::BodyPartitionsType partitions;
+	for (size_t i = 0; i < partitions.size(); i++) {
+		for (size_t j = 0; j < partitions.size(); j++) {
+			partitions[j] = j < i ? Stable : (j == i ? Delta : Full);
+		}
+		if (not emptyBody<RULE_TYPE>(state, partitions)) {
+			f(partitions);
+		}
+	}
+}
+
+// append the facts of a partition that match the constants (and bound variables) of a body atom to its view
+template <size_t I, typename RULE_TYPE, typename STATE_TYPE>
+void selectPartition(const RULE_TYPE &rule, const Frame &frame, const STATE_TYPE &state, Partition partition,
+	typename STATE_TYPE::IndicesType &indices, typename RULE_TYPE::RuleType::BodyViewsType &views)
+{
+	typedef typename tuple_element<I, typename RULE_TYPE::RuleType::BodyRelations>::type RelationType;
+	const auto &atom = get<I>(rule.body);
+	const auto &slots = get<I>(rule.layout.body);
+	const size_t positions = boundPositions(atom, slots, frame);
+	auto &view = get<I>(views);
+	forEachMatch<RelationType>(state.template partition<RelationType>(partition), partition, ground<RelationType>(atom, slots, frame, positions),
+		positions, get<RelationIndices<RelationType>>(indices), [&view](const auto &it) { view.push_back(it); });
+}
+
+template <size_t I, typename RULE_TYPE, typename STATE_TYPE>
+bool selectFacts(const RULE_TYPE &rule, const Frame &frame, const STATE_TYPE &state, unsigned partitions,
+	typename STATE_TYPE::IndicesType &indices, typename RULE_TYPE::RuleType::BodyViewsType &views)
+{
+	get<I>(views).clear();
+	for (Partition partition : {Stable, Delta}) {
+		if (partitions & partition) {
+			selectPartition<I>(rule, frame, state, partition, indices, views);
+		}
+	}
+	return not get<I>(views).empty();
 }
 
-template<typename RULE_TYPE, typename STATE_TYPE, size_t ... Is>
-bool unseenSlicePossible(const typename STATE_TYPE::StateSizesType& stateSizeDelta, index_sequence<Is...>) {
-	return ((unseenSlicePossible<Is, RULE_TYPE, STATE_TYPE>(stateSizeDelta)) or ...);
+template <typename RULE_TYPE, typename STATE_TYPE, size_t... Is>
+bool selectFacts(const RULE_TYPE &rule, const Frame &frame, const STATE_TYPE &state,
+	const typename RULE_TYPE::RuleType::BodyPartitionsType &partitions, typename STATE_TYPE::IndicesType &indices,
+	typename RULE_TYPE::RuleType::BodyViewsType &views, index_sequence<Is...>)
+{
+	return ((selectFacts<Is>(rule, frame, state, partitions[Is], indices, views)) and ...);
 }
 
-template<typename RULE_TYPE, typename STATE_TYPE>
-bool unseenSlicePossible(const typename STATE_TYPE::StateSizesType& stateSizeDelta) {
-	auto indexSequence = make_index_sequence<tuple_size<typename RULE_TYPE::BodyRelations>::value>{};
-	return unseenSlicePossible<RULE_TYPE, STATE_TYPE>(stateSizeDelta, indexSequence);
+// views of the facts of each body atom that match its constants (and the variables bound in a
+// frame), false if some view is empty
+template <typename RULE_TYPE, typename STATE_TYPE>
+bool selectFacts(const RULE_TYPE &rule, const Frame &frame, const STATE_TYPE &state,
+	const typename RULE_TYPE::RuleType::BodyPartitionsType &partitions, typename STATE_TYPE::IndicesType &indices,
+	typename RULE_TYPE::RuleType::BodyViewsType &views)
+{
+	return selectFacts(rule, frame, state, partitions, indices, views, make_index_sequence<tuple_size<typename RULE_TYPE::RuleType::BodyRelations>::value>{});
 }
 
 template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-bool bindExternals(const RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule) {
+bool bindExternals(const RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>&, Frame &) {
 	return true;
 }
 
 template<size_t I, typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-bool bindExternal(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule) {
+bool bindExternal(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, Frame &frame) {
 	auto& external = get<I>(rule.externals.externals);
 	auto value = external.externalFunction();
 	//cout << "external function returned " << value << endl;
-	auto& bindVariable = external.bindVariable;
-	return datalog::bind(value, bindVariable);
+	return datalog::bind(value, external.bindVariable, frame, rule.layout.externals[I]);
 }
 
 template <typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs, size_t ... Is>
-bool bindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, index_sequence<Is...>) {
-	return ((bindExternal<Is>(rule)) and ...);
+bool bindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, Frame &frame, index_sequence<Is...>) {
+	return ((bindExternal<Is>(rule, frame)) and ...);
 }
 
 template <typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-bool bindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule) {
-	return bindExternals(rule, make_index_sequence<tuple_size<typename Externals<Ts...>::ExternalsTupleType>::value>{});
+bool bindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, Frame &frame) {
+	// external functions read the variables of the rule in its frame
+	const Frame::Activation activation{frame};
+	return bindExternals(rule, frame, make_index_sequence<tuple_size<typename Externals<Ts...>::ExternalsTupleType>::value>{});
 }
 
-template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-void unbindExternals(const RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule) {}
-
 template<size_t I, typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-void unbindExternal(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule) {
+void unbindExternal(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, Frame &frame) {
 	auto& external = get<I>(rule.externals.externals);
-	auto& bindVariable = external.bindVariable;
-	bindVariable->unbind();
+	unbind(external.bindVariable, frame, rule.layout.externals[I]);
+}
+
+// Externals whose variables are already bound by the body act as filters, and must stay bound
+// when the externals are unbound
+
+template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
+size_t boundExternals(const RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>&, const Frame &) {
+	return 0;
+}
+
+template <typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs, size_t ... Is>
+size_t boundExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, const Frame &frame,
+	index_sequence<Is...>) {
+	return ((isBound(get<Is>(rule.externals.externals).bindVariable, frame, rule.layout.externals[Is]) ? size_t{1} << Is : size_t{0}) | ... | size_t{0});
 }
 
+template <typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
+size_t boundExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, const Frame &frame) {
+	return boundExternals(rule, frame, make_index_sequence<tuple_size<typename Externals<Ts...>::ExternalsTupleType>::value>{});
+}
+
+template <typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
+void unbindExternals(const RuleInstance<HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>&, Frame &, size_t) {}
+
 template <typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs, size_t ... Is>
-void unbindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, index_sequence<Is...>) {
-	return ((unbindExternal<Is>(rule)), ...);
+void unbindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, Frame &frame, size_t bound,
+	index_sequence<Is...>) {
+	((bound & (size_t{1} << Is) ? void() : unbindExternal<Is>(rule, frame)), ...);
 }
 
+// unbind the variables of the externals of a rule, other than those that were bound before they ran
 template <typename... Ts, typename HEAD_ATOM_SPECIFIER, typename... BODY_ATOM_SPECIFIERs>
-void unbindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule) {
-	unbindExternals(rule, make_index_sequence<tuple_size<typename Externals<Ts...>::ExternalsTupleType>::value>{});
+void unbindExternals(const ExternalRuleInstance<Externals<Ts...>, HEAD_ATOM_SPECIFIER, BODY_ATOM_SPECIFIERs...>& rule, Frame &frame, size_t bound) {
+	unbindExternals(rule, frame, bound, make_index_sequence<tuple_size<typename Externals<Ts...>::ExternalsTupleType>::value>{});
 }
 
+// Evaluation strategies for rule bodies
+
+// Enumerate every combination of body facts, then try to bind each combination
+struct CartesianJoin {};
+
+// Bind body atoms one at a time, looking up each atom in a secondary index keyed on its
+// argument positions that are constants or already bound by earlier atoms. Atoms are ordered
+// per delta variant by estimated cost, from the current sizes of the partitions they range over.
+struct IndexedJoin {};
+
+// As IndexedJoin but with hashed indices. Two-atom bodies probe the larger side and build the
+// index on the smaller side.
+struct HashJoin {};
+
+// Bind body atoms one at a time without secondary indices: each atom is scanned (or range scanned
+// on its bound leading arguments) and the search backtracks as soon as a fact fails to bind. This
+// is the default strategy.
+struct NestedLoopJoin {};
+
 template <typename RULE_TYPE, typename STATE_TYPE>
 RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyRule(
-	size_t iteration, 
-	const typename STATE_TYPE::StateSizesType& stateSizeDelta,
-	RULE_TYPE &rule, 
-	const STATE_TYPE &state
+	CartesianJoin,
+	const RULE_TYPE &rule, 
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *
 )
 {
 	typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+	typedef typename RULE_TYPE::RuleType RuleType;
 	RelationSet<HeadRelationType> derivedFacts;
-	// does the body of this rule refer to relations with unseen data?
-	if (unseenSlicePossible<typename RULE_TYPE::RuleType, STATE_TYPE>(stateSizeDelta)) {
-		// OK, we now exhaustively check all relations for unseen combinations
-		auto it = state.template it<typename RULE_TYPE::RuleType>();
+	typename RuleType::BodyViewsType views;
+	Frame frame{rule.layout.frame};
+	auto applyPartitions = [&rule, &state, &indices, &views, &derivedFacts, &frame](const typename RuleType::BodyPartitionsType &partitions) {
+		// only facts that match the constants of each atom can bind
+		frame.clear();
+		if (not selectFacts(rule, frame, state, partitions, indices, views)) {
+			return;
+		}
+		// exhaustively check all combinations of the selected facts
+		auto it = state.template it<RuleType>(views);
 		while (it.hasNext())
 		{
 			auto slice = it.next();
-			// does this slice contain an unseen combination of ground atoms?
-			if (unseenSlice<typename RULE_TYPE::RuleType>(iteration, slice)) {
-				// unbind all the Variables
-				unbind<RULE_TYPE>(rule.body);
-				unbindExternals(rule);
-				// try to bind rule body with slice
-				if (bindBodyAtomsToSlice<RULE_TYPE, typename RULE_TYPE::RuleType>(rule.body, slice))
-				{
-					// run any externals
-					if (bindExternals(rule)) {
-						// successful bind, therefore add (grounded) head atom to new state
-						derivedFacts.set.insert({iteration + 1, ground<HeadRelationType>(rule.head)});
-					}
+			// unbind all the Variables
+			frame.clear();
+			// try to bind rule body with slice
+			if (bindBodyAtomsToSlice<RULE_TYPE, RuleType>(rule, slice, frame))
+			{
+				// run any externals
+				if (bindExternals(rule, frame)) {
+					// successful bind, therefore add (grounded) head atom to new state
+					derivedFacts.set.insert(ground<HeadRelationType>(rule.head, rule.layout.head, frame));
 				}
-			} 
+			}
 		}
-	} 
+	};
+	forEachDeltaVariant<RuleType>(state, applyPartitions);
 	return derivedFacts;
 }
 
-template <typename RELATION_TYPE>
-void merge(RelationSet<RELATION_TYPE>& s1, RelationSet<RELATION_TYPE>&s2)
-{
-	s2.set.merge(s1.set);
-}
+template <typename RULE_TYPE, typename STATE_TYPE, typename EVALUATION>
+struct IndexedBodyJoin {
+	typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+	typedef typename RULE_TYPE::RuleType::BodyRelations BodyRelations;
+	typedef typename RULE_TYPE::RuleType::BodyPartitionsType PartitionsType;
+	typedef typename STATE_TYPE::IndicesType IndicesType;
+	static constexpr size_t bodySize = tuple_size<BodyRelations>::value;
+	typedef array<size_t, bodySize> OrderType;
+
+	// the facts of the outermost atom are split into chunks of at least this many facts, and at most
+	// this many chunks per thread of the pool
+	static constexpr size_t minimumChunk = 32;
+	static constexpr size_t chunksPerThread = 4;
+
+	IndexedBodyJoin(const RULE_TYPE &rule, const STATE_TYPE &state, IndicesType &indices,
+		RelationSet<HeadRelationType> &derivedFacts, ThreadPool *pool = nullptr)
+		: rule(rule), state(state), indices(indices), derivedFacts(derivedFacts), frame(rule.layout.frame), pool(pool)
+	{
+		analyse(make_index_sequence<bodySize>{});
+	}
 
-template<size_t I, typename STATE_RELATIONS_TYPE>
-void merge(STATE_RELATIONS_TYPE& newState, STATE_RELATIONS_TYPE& state) {
-	auto& newSet = get<I>(newState.stateRelations);
-	auto& set = get<I>(state.stateRelations);
-	merge(newSet, set);
-}
+	void join(const PartitionsType &bodyPartitions) {
+		partitions = bodyPartitions;
+		const auto sizes = bodySizes<typename RULE_TYPE::RuleType>(state, partitions);
+		if constexpr (is_same<EVALUATION, HashJoin>::value and bodySize == 2) {
+			// probe the larger side
+			order = sizes[1] > sizes[0] ? OrderType{{1, 0}} : OrderType{{0, 1}};
+		} else {
+			plan(sizes);
+		}
+		analysePositions();
+		frame.clear();
+		if (pool and pool->concurrency() > 1) {
+			static const auto chunkedAtoms = joinChunkAtoms(make_index_sequence<bodySize>{});
+			(this->*chunkedAtoms[order[0]])();
+		} else {
+			join(0);
+		}
+	}
 
-template <size_t ... Is, typename STATE_RELATIONS_TYPE>
-void merge(STATE_RELATIONS_TYPE& newState, STATE_RELATIONS_TYPE& state, index_sequence<Is...>) {
-	((merge<Is>(newState, state)), ...);
-}
+private:
+	typedef void (IndexedBodyJoin::*JoinAtomType)(size_t);
+	typedef void (IndexedBodyJoin::*JoinChunksType)();
+
+	// a join of a chunk of the facts of the outermost atom, into facts of its own, in the plan of
+	// the join that splits them
+	IndexedBodyJoin(const IndexedBodyJoin &join, RelationSet<HeadRelationType> &derivedFacts)
+		: rule(join.rule), state(join.state), indices(join.indices), derivedFacts(derivedFacts), frame(rule.layout.frame),
+		pool(nullptr), partitions(join.partitions), arguments(join.arguments), order(join.order), positions(join.positions)
+	{}
+
+	template <size_t... Is>
+	void analyse(index_sequence<Is...>) {
+		((arguments[Is] = apply([](const auto &... args) { return vector<const void *>{variableOf(args)...}; }, get<Is>(rule.body))), ...);
+	}
 
-template<typename ... RELATIONs>
-void merge(State<RELATIONs...> &newState, State<RELATIONs...> &state) {
-	typedef typename State<RELATIONs...>::StateRelationsType StateRelationsType;
-	return merge(newState, state, make_index_sequence<tuple_size<StateRelationsType>::value>{});
-}
+	// Greedily order the atoms by the estimated number of facts that match each, given the variables
+	// bound by the atoms before it: a relation of n facts with b of its k arguments bound is
+	// estimated to match n^((k - b) / k) facts
+	void plan(const array<size_t, bodySize> &sizes) {
+		array<bool, bodySize> placed{};
+		vector<const void *> bound;
+		for (size_t depth = 0; depth < bodySize; depth++) {
+			size_t best = bodySize;
+			double bestCost = 0;
+			for (size_t i = 0; i < bodySize; i++) {
+				if (placed[i]) {
+					continue;
+				}
+				const auto &atomArguments = arguments[i];
+				const size_t boundArguments = count_if(atomArguments.begin(), atomArguments.end(), [&bound](const void *variable) {
+					return not variable or find(bound.begin(), bound.end(), variable) != bound.end();
+				});
+				const size_t arity = atomArguments.size();
+				const double cost = arity ? pow(double(sizes[i]), double(arity - boundArguments) / arity) : 1;
+				if (best == bodySize or cost < bestCost) {
+					best = i;
+					bestCost = cost;
+				}
+			}
+			order[depth] = best;
+			placed[best] = true;
+			for (const void *variable : arguments[best]) {
+				if (variable) {
+					bound.push_back(variable);
+				}
+			}
+		}
+	}
 
-template <typename RELATION_TYPE, typename ... RELATIONs>
-void assign(RelationSet<RELATION_TYPE>&& facts, State<RELATIONs...> &state) {
-	typedef RelationSet<RELATION_TYPE> SetType;
-	merge(facts, get<SetType>(state.stateRelations));
-}
+	// the positions of each atom that are constants or bound by the atoms before it in the order
+	void analysePositions() {
+		vector<const void *> bound;
+		for (size_t i : order) {
+			const auto &atomArguments = arguments[i];
+			positions[i] = 0;
+			for (size_t p = 0; p < atomArguments.size(); p++) {
+				const void *variable = atomArguments[p];
+				if (not variable or find(bound.begin(), bound.end(), variable) != bound.end()) {
+					positions[i] |= size_t{1} << p;
+				}
+			}
+			for (const void *variable : atomArguments) {
+				if (variable) {
+					bound.push_back(variable);
+				}
+			}
+		}
+	}
 
-template <typename ... RULE_TYPEs>
-struct RuleSet {
-	tuple<RULE_TYPEs...> rules;
-};
+	template <size_t... Is>
+	static array<JoinAtomType, bodySize> joinAtoms(index_sequence<Is...>) {
+		return {{&IndexedBodyJoin::joinAtom<Is>...}};
+	}
 
-template <typename ... RULE_TYPEs>
-RuleSet<RULE_TYPEs...> ruleset(RULE_TYPEs&&... r) {
-	return RuleSet<RULE_TYPEs...>{{r...}};
-}
+	template <size_t... Is>
+	static array<JoinChunksType, bodySize> joinChunkAtoms(index_sequence<Is...>) {
+		return {{&IndexedBodyJoin::joinChunks<Is>...}};
+	}
 
-template <typename ... RULE_TYPEs, typename... RELATIONs>
-void applyRuleSet(
-	size_t iteration, 
-	typename State<RELATIONs...>::StateSizesType& stateSizeDelta,
-	const RuleSet<RULE_TYPEs...> &ruleSet, 
-	State<RELATIONs...> &state
-) {
-	// compute new state
-	State<RELATIONs...> newState;
-	apply([&iteration, &stateSizeDelta, &state, &newState](auto &&... args) { 
-		((assign(applyRule(iteration, stateSizeDelta, args, state), newState)), ...); 
-	}, ruleSet.rules);
-	// merge new state
-	typename State<RELATIONs...>::StateSizesType before;
-	state.sizes(before);
-	merge(newState, state);
-	state.sizes(stateSizeDelta);
-	state.diff(stateSizeDelta, before);
-}
+	void join(size_t depth) {
+		static const auto atoms = joinAtoms(make_index_sequence<bodySize>{});
+		if (depth == bodySize) {
+			emit();
+		} else {
+			(this->*atoms[order[depth]])(depth);
+		}
+	}
 
-template <typename ... RULE_TYPEs, typename... RELATIONs>
-State<RELATIONs...> fixPoint(const RuleSet<RULE_TYPEs...> &ruleSet, const State<RELATIONs...> &state) {
-	typedef State<RELATIONs...> StateType;
-	StateType newState{state};
-	typename State<RELATIONs...>::StateSizesType stateSizeDelta;
-	size_t iteration = 0; // TODO: make this the max iterator in state, to allow warm restart
-	do {
-		applyRuleSet(iteration, stateSizeDelta, ruleSet, newState);
-		iteration++;
-	} while (StateType::size(stateSizeDelta) > 0);
-	//cout << "fix point in " << iteration << " iterations" << endl;
-	return newState;
+	// the positions of an atom that narrow the facts it is matched against
+	template <size_t I>
+	size_t matchPositions() const {
+		if constexpr (is_same<EVALUATION, NestedLoopJoin>::value) {
+			// only the bound leading arguments narrow the scan, binding rejects the rest
+			return (size_t{1} << prefixLength(positions[I])) - 1;
+		} else {
+			return positions[I];
+		}
+	}
+
+	// visit the facts of the partitions of an atom that match its bound positions
+	template <size_t I, typename F>
+	void forEachFact(F f) {
+		typedef typename tuple_element<I, BodyRelations>::type RelationType;
+		const size_t matched = matchPositions<I>();
+		assert(positions[I] == boundPositions(get<I>(rule.body), get<I>(rule.layout.body), frame));
+		const auto key = ground<RelationType>(get<I>(rule.body), get<I>(rule.layout.body), frame, matched);
+		auto &relationIndices = get<RelationIndices<RelationType>>(indices);
+		for (Partition partition : {Stable, Delta}) {
+			if (not (partitions[I] & partition)) {
+				continue;
+			}
+			const auto &set = state.template partition<RelationType>(partition);
+			if constexpr (is_same<EVALUATION, HashJoin>::value) {
+				if (matched) {
+					const auto &index = relationIndices.hashIndex(set, partition, matched);
+					if (const auto *facts = index.find(key)) {
+						for (const auto &it : *facts) {
+							f(it);
+						}
+					}
+					continue;
+				}
+			}
+			forEachMatch<RelationType>(set, partition, key, matched, relationIndices, f);
+		}
+	}
+
+	// bind a fact to an atom and join the atoms after it
+	template <size_t I, typename ITERATOR_TYPE>
+	void joinFact(const ITERATOR_TYPE &it, size_t depth) {
+		typedef typename tuple_element<I, BodyRelations>::type RelationType;
+		const auto &atom = get<I>(rule.body);
+		const auto &slots = get<I>(rule.layout.body);
+		if (datalog::bind(*it, atom, slots, frame)) {
+			join(depth + 1);
+		}
+		// variables first bound by this atom are unbound before trying the next fact
+		unbind(atom, slots, frame, allPositions<RelationType>() & ~positions[I]);
+	}
+
+	template <size_t I>
+	void joinAtom(size_t depth) {
+		forEachFact<I>([this, depth](const auto &it) {
+			joinFact<I>(it, depth);
+		});
+	}
+
+	// build the indices that the atoms after the outermost one look up, so that the joins of chunks
+	// share them without modifying them
+	template <size_t I>
+	void prepareAtom() {
+		typedef typename tuple_element<I, BodyRelations>::type RelationType;
+		if (I == order[0]) {
+			return;
+		}
+		const size_t matched = matchPositions<I>();
+		auto &relationIndices = get<RelationIndices<RelationType>>(indices);
+		for (Partition partition : {Stable, Delta}) {
+			if (not (partitions[I] & partition)) {
+				continue;
+			}
+			const auto &set = state.template partition<RelationType>(partition);
+			if constexpr (is_same<EVALUATION, HashJoin>::value) {
+				if (matched) {
+					relationIndices.hashIndex(set, partition, matched);
+					continue;
+				}
+			}
+			if (matchesByIndex<RelationType>(matched)) {
+				relationIndices.index(set, partition, matched);
+			}
+		}
+	}
+
+	template <size_t... Is>
+	void prepareAtoms(index_sequence<Is...>) {
+		((prepareAtom<Is>()), ...);
+	}
+
+	// Split the facts of the outermost atom into chunks, and join each chunk on the pool: into the
+	// derived facts, if their set takes concurrent inserts, otherwise into facts of its own, which are
+	// then merged
+	template <size_t I>
+	void joinChunks() {
+		typedef typename tuple_element<I, BodyRelations>::type RelationType;
+		vector<typename RelationType::TrackedSet::const_iterator> facts;
+		forEachFact<I>([&facts](const auto &it) {
+			facts.push_back(it);
+		});
+		const size_t chunks = min(pool->concurrency() * chunksPerThread, facts.size() / minimumChunk);
+		if (chunks < 2) {
+			for (const auto &it : facts) {
+				joinFact<I>(it, 0);
+			}
+			return;
+		}
+		prepareAtoms(make_index_sequence<bodySize>{});
+		constexpr bool shared = hasConcurrentInserts<typename HeadRelationType::TrackedSet>::value;
+		vector<RelationSet<HeadRelationType>> chunkFacts(shared ? 0 : chunks);
+		vector<function<void()>> tasks;
+		for (size_t c = 0; c < chunks; c++) {
+			tasks.push_back([this, &facts, &chunkFacts, c, chunks]() {
+				IndexedBodyJoin chunkJoin{*this, shared ? derivedFacts : chunkFacts[c]};
+				for (size_t f = facts.size() * c / chunks; f < facts.size() * (c + 1) / chunks; f++) {
+					chunkJoin.template joinFact<I>(facts[f], 0);
+				}
+			});
+		}
+		pool->run(tasks);
+		for (auto &chunk : chunkFacts) {
+			derivedFacts.set.merge(chunk.set);
+		}
+	}
+
+	void emit() {
+		const size_t bound = boundExternals(rule, frame);
+		if (bindExternals(rule, frame)) {
+			derivedFacts.set.insert(ground<HeadRelationType>(rule.head, rule.layout.head, frame));
+		}
+		unbindExternals(rule, frame, bound);
+	}
+
+	const RULE_TYPE &rule;
+	const STATE_TYPE &state;
+	IndicesType &indices;
+	RelationSet<HeadRelationType> &derivedFacts;
+	// the bindings of the variables of the rule
+	Frame frame;
+	// the pool that joins chunks of the outermost atom, if any
+	ThreadPool *pool;
+	PartitionsType partitions;
+	// the variable at each argument position of each atom, nullptr for constants
+	array<vector<const void *>, bodySize> arguments;
+	OrderType order;
+	// the bound positions of each atom, when it is joined in that order
+	array<size_t, bodySize> positions;
+};
+
+template <typename RULE_TYPE, typename STATE_TYPE, typename EVALUATION>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyIndexedJoin(
+	EVALUATION,
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *pool = nullptr
+)
+{
+	typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+	RelationSet<HeadRelationType> derivedFacts;
+	IndexedBodyJoin<RULE_TYPE, STATE_TYPE, EVALUATION> bodyJoin{rule, state, indices, derivedFacts, pool};
+	forEachDeltaVariant<typename RULE_TYPE::RuleType>(state, [&bodyJoin](const auto &partitions) {
+		bodyJoin.join(partitions);
+	});
+	return derivedFacts;
+}
+
+template <typename RULE_TYPE, typename STATE_TYPE>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyRule(
+	IndexedJoin evaluation,
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *pool
+)
+{
+	return applyIndexedJoin(evaluation, rule, state, indices, pool);
+}
+
+template <typename RULE_TYPE, typename STATE_TYPE>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyRule(
+	HashJoin evaluation,
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *pool
+)
+{
+	return applyIndexedJoin(evaluation, rule, state, indices, pool);
+}
+
+template <typename RULE_TYPE, typename STATE_TYPE>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyRule(
+	NestedLoopJoin evaluation,
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *pool
+)
+{
+	return applyIndexedJoin(evaluation, rule, state, indices, pool);
+}
+
+// Join the body of a rule over placeholders as planned at compile time, as a pipeline that pushes the
+// facts of each atom, in the order they are written, through stages instantiated for that atom:
+//  - scan or probe: the facts that match the key of the atom's bound positions, which are constants
+//    or placeholders read from the facts of earlier atoms. The outermost atom is matched once per
+//    delta variant, so it is scanned (on its bound prefix, if its set is ordered) rather than given
+//    an index for one lookup; inner atoms probe indices as IndexedJoin does.
+//  - filter: the bound positions that the scan did not match on, and the positions that repeat a
+//    placeholder of the same atom
+//  - emit: the head projected from the facts of the body, inserted into a sink
+// No variables are bound, so there is nothing to unbind.
+template <typename RULE_TYPE, typename STATE_TYPE>
+struct StaticBodyJoin {
+	typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+	typedef typename RULE_TYPE::RuleType::BodyRelations BodyRelations;
+	typedef typename RULE_TYPE::RuleType::BodyPartitionsType PartitionsType;
+	typedef typename RULE_TYPE::PlanType Plan;
+	typedef typename STATE_TYPE::IndicesType IndicesType;
+
+	StaticBodyJoin(const RULE_TYPE &rule, const STATE_TYPE &state, IndicesType &indices, RelationSet<HeadRelationType> &sink)
+		: rule(rule), state(state), indices(indices), sink(sink)
+	{}
+
+	void join(const PartitionsType &bodyPartitions) {
+		partitions = bodyPartitions;
+		joinAtom<0>(tuple<>{});
+	}
+
+private:
+	// the positions of an atom that its facts are looked up on
+	template <size_t I>
+	static constexpr size_t lookupPositions() {
+		typedef typename tuple_element<I, BodyRelations>::type RelationType;
+		constexpr size_t bound = Plan::boundPositions(I);
+		if constexpr (I == 0) {
+			if (matchesByIndex<RelationType>(bound)) {
+				return RelationType::Storage::ordered ? (size_t{1} << prefixLength(bound)) - 1 : 0;
+			}
+		}
+		return bound;
+	}
+
+	// the positions of an atom that its facts are filtered on
+	template <size_t I>
+	static constexpr size_t filterPositions() {
+		return (Plan::boundPositions(I) & ~lookupPositions<I>()) | Plan::repeatedPositions(I);
+	}
+
+	// the value of a placeholder, from the fact of the atom where it first occurs
+	template <size_t PLACEHOLDER, typename FACTS_TYPE>
+	static const auto &value(const FACTS_TYPE &facts) {
+		constexpr auto source = Plan::source(PLACEHOLDER);
+		return get<source.position>(get<source.atom>(facts));
+	}
+
+	template <size_t I, typename FACTS_TYPE, size_t... Cs>
+	typename tuple_element<I, BodyRelations>::type::Ground key(const FACTS_TYPE &facts, index_sequence<Cs...>) const {
+		typename tuple_element<I, BodyRelations>::type::Ground key{};
+		([&key, &facts, this]() {
+			constexpr size_t placeholder = Plan::body[I][Cs];
+			if constexpr (placeholder == noPlaceholder) {
+				get<Cs>(key) = get<Cs>(get<I>(rule.body));
+			} else if constexpr (Plan::source(placeholder).atom < I) {
+				get<Cs>(key) = value<placeholder>(facts);
+			}
+		}(), ...);
+		return key;
+	}
+
+	// does a fact match the key of its atom, and repeat the placeholders of the atom, at the filtered positions?
+	template <size_t I, typename GROUND_TYPE, size_t... Cs>
+	static bool filter(const GROUND_TYPE &fact, const GROUND_TYPE &key, index_sequence<Cs...>) {
+		return ([&fact, &key]() {
+			if constexpr ((filterPositions<I>() & Plan::repeatedPositions(I) & (size_t{1} << Cs)) != 0) {
+				return get<Cs>(fact) == get<Plan::source(Plan::body[I][Cs]).position>(fact);
+			} else if constexpr ((filterPositions<I>() & (size_t{1} << Cs)) != 0) {
+				return get<Cs>(fact) == get<Cs>(key);
+			} else {
+				return true;
+			}
+		}() and ...);
+	}
+
+	template <size_t I, typename FACTS_TYPE>
+	void joinAtom(const FACTS_TYPE &facts) {
+		if constexpr (I == Plan::bodySize) {
+			emit(facts, make_index_sequence<tuple_size<typename HeadRelationType::Ground>::value>{});
+		} else {
+			typedef typename tuple_element<I, BodyRelations>::type RelationType;
+			typedef make_index_sequence<tuple_size<typename RelationType::Ground>::value> Positions;
+			const auto atomKey = key<I>(facts, Positions{});
+			auto &relationIndices = get<RelationIndices<RelationType>>(indices);
+			for (Partition partition : {Stable, Delta}) {
+				if (not (partitions[I] & partition)) {
+					continue;
+				}
+				const auto &set = state.template partition<RelationType>(partition);
+				forEachMatch<RelationType>(set, partition, atomKey, lookupPositions<I>(), relationIndices, [this, &facts, &atomKey](const auto &it) {
+					const auto &fact = *it;
+					if constexpr (filterPositions<I>() != 0) {
+						if (not filter<I>(fact, atomKey, Positions{})) {
+							return;
+						}
+					}
+					joinAtom<I + 1>(tuple_cat(facts, tie(fact)));
+				});
+			}
+		}
+	}
+
+	template <size_t C, typename FACTS_TYPE>
+	typename tuple_element<C, typename HeadRelationType::Ground>::type headArgument(const FACTS_TYPE &facts) const {
+		constexpr size_t placeholder = Plan::head[C];
+		if constexpr (placeholder == noPlaceholder) {
+			return get<C>(rule.head);
+		} else {
+			return value<placeholder>(facts);
+		}
+	}
+
+	// project the head from the facts of the body
+	template <typename FACTS_TYPE, size_t... Cs>
+	void emit(const FACTS_TYPE &facts, index_sequence<Cs...>) {
+		sink.set.insert(typename HeadRelationType::Ground{headArgument<Cs>(facts)...});
+	}
+
+	const RULE_TYPE &rule;
+	const STATE_TYPE &state;
+	IndicesType &indices;
+	RelationSet<HeadRelationType> &sink;
+	PartitionsType partitions;
+};
+
+// Derive the facts of a rule over placeholders into a set, which may be the set of its head relation
+// in the next state
+template <typename RULE_TYPE, typename STATE_TYPE>
+void applyStaticJoin(
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> &sink
+)
+{
+	StaticBodyJoin<RULE_TYPE, STATE_TYPE> bodyJoin{rule, state, indices, sink};
+	forEachDeltaVariant<typename RULE_TYPE::RuleType>(state, [&bodyJoin](const auto &partitions) {
+		bodyJoin.join(partitions);
+	});
+}
+
+// compare two facts on one column
+template <typename GROUND_TYPE, size_t... Cs>
+int compareColumn(const GROUND_TYPE &a, const GROUND_TYPE &b, size_t column, index_sequence<Cs...>)
+{
+	int c = 0;
+	((Cs == column ? (c = get<Cs>(a) < get<Cs>(b) ? -1 : (get<Cs>(b) < get<Cs>(a) ? 1 : 0)) : 0), ...);
+	return c;
+}
+
+// sort facts on the given columns, in order
+template <typename RELATION_TYPE>
+void sortFacts(vector<typename RELATION_TYPE::TrackedSet::const_iterator> &facts, const vector<size_t> &columns)
+{
+	typedef typename RELATION_TYPE::Ground Ground;
+	sort(facts.begin(), facts.end(), [&columns](const auto &a, const auto &b) {
+		for (size_t column : columns) {
+			const int c = compareColumn(*a, *b, column, make_index_sequence<tuple_size<Ground>::value>{});
+			if (c) {
+				return c < 0;
+			}
+		}
+		return false;
+	});
+}
+
+// Join the body one variable at a time: the values of each variable are intersected across all
+// atoms in which it occurs by leapfrogging over sorted views of the atoms' facts. Unlike pairwise
+// joins this stays within the worst-case output size of cyclic bodies (leapfrog triejoin).
+struct LeapfrogJoin {};
+
+template <typename RULE_TYPE, typename STATE_TYPE>
+struct LeapfrogBodyJoin {
+	typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+	typedef typename RULE_TYPE::RuleType::BodyRelations BodyRelations;
+	typedef typename RULE_TYPE::RuleType::BodyPartitionsType PartitionsType;
+	typedef typename RULE_TYPE::RuleType::BodyViewsType ViewsType;
+	static constexpr size_t N = tuple_size<BodyRelations>::value;
+
+	LeapfrogBodyJoin(const RULE_TYPE &rule, const STATE_TYPE &state, typename STATE_TYPE::IndicesType &indices,
+		RelationSet<HeadRelationType> &derivedFacts)
+		: rule(rule), state(state), indices(indices), derivedFacts(derivedFacts), frame(rule.layout.frame)
+	{
+		analyse(make_index_sequence<N>{});
+	}
+
+	void join(const PartitionsType &partitions) {
+		if (buildViews(partitions, make_index_sequence<N>{})) {
+			join(0);
+		}
+	}
+
+private:
+	// an occurrence of a variable in a body atom, with the operations on that argument position
+	struct Occurrence {
+		size_t atom;
+		size_t column;
+		// compare the value at a position of the atom's view with the value of the variable
+		int (LeapfrogBodyJoin::*compareKey)(size_t) const;
+		// bind the variable to the value at a position of the atom's view
+		void (LeapfrogBodyJoin::*bindKey)(size_t);
+		void (LeapfrogBodyJoin::*unbindKey)();
+	};
+
+	typedef pair<size_t, size_t> Range;
+
+	template <typename T>
+	static int compareValue(const T &key, const T &value) {
+		return key < value ? -1 : (value < key ? 1 : 0);
+	}
+
+	template <size_t I, size_t C>
+	struct Value {
+		typedef typename tuple_element<C, typename tuple_element<I, BodyRelations>::type::Ground>::type type;
+	};
+
+	template <size_t I, size_t C>
+	int compareKey(size_t position) const {
+		// the fact is not held by reference, as the iterators of columnar sets return facts by value
+		return compareValue(get<C>(*get<I>(views)[position]), *frame.template slot<typename Value<I, C>::type>(get<C>(get<I>(rule.layout.body))));
+	}
+
+	template <size_t I, size_t C>
+	void bindKey(size_t position) {
+		frame.template slot<typename Value<I, C>::type>(get<C>(get<I>(rule.layout.body))).emplace(get<C>(*get<I>(views)[position]));
+	}
+
+	template <size_t I, size_t C>
+	void unbindKey() {
+		frame.template slot<typename Value<I, C>::type>(get<C>(get<I>(rule.layout.body))).reset();
+	}
+
+	template <size_t I, size_t C>
+	void analyseArgument() {
+		typedef typename decay<typename tuple_element<C, typename decay<decltype(get<I>(rule.body))>::type>::type>::type ArgumentType;
+		if constexpr (isVariable<ArgumentType>::value) {
+			const void *variable = get<C>(get<I>(rule.body));
+			auto it = find(variables.begin(), variables.end(), variable);
+			const size_t v = it - variables.begin();
+			if (it == variables.end()) {
+				variables.push_back(variable);
+				occurrences.emplace_back();
+			}
+			occurrences[v].push_back({I, C, &LeapfrogBodyJoin::compareKey<I, C>, &LeapfrogBodyJoin::bindKey<I, C>, &LeapfrogBodyJoin::unbindKey<I, C>});
+		}
+	}
+
+	template <size_t I, size_t... Cs>
+	void analyseAtom(index_sequence<Cs...>) {
+		((analyseArgument<I, Cs>()), ...);
+	}
+
+	template <size_t... Is>
+	void analyse(index_sequence<Is...>) {
+		((analyseAtom<Is>(make_index_sequence<tuple_size<typename tuple_element<Is, BodyRelations>::type::Ground>::value>{})), ...);
+		// each atom's view is sorted on its variable columns, in variable order
+		for (const auto &variableOccurrences : occurrences) {
+			for (const auto &occurrence : variableOccurrences) {
+				columnOrders[occurrence.atom].push_back(occurrence.column);
+			}
+		}
+		// the first occurrence of a variable in each atom leapfrogs, further occurrences only narrow
+		levels.resize(occurrences.size());
+		narrowings.resize(occurrences.size());
+		positions.resize(occurrences.size());
+		ends.resize(occurrences.size());
+		runEnds.resize(occurrences.size());
+		for (size_t v = 0; v < occurrences.size(); v++) {
+			for (const auto &occurrence : occurrences[v]) {
+				const bool first = none_of(levels[v].begin(), levels[v].end(), [&occurrence](const Occurrence &o) {
+					return o.atom == occurrence.atom;
+				});
+				(first ? levels[v] : narrowings[v]).push_back(occurrence);
+			}
+			positions[v].resize(levels[v].size());
+			ends[v].resize(levels[v].size());
+			runEnds[v].resize(levels[v].size());
+		}
+	}
+
+	// a view of the facts of an atom that match its constants, sorted on its variable columns
+	template <size_t I>
+	bool buildView(const PartitionsType &partitions) {
+		typedef typename tuple_element<I, BodyRelations>::type RelationType;
+		auto &view = get<I>(views);
+		if (not selectFacts<I>(rule, frame, state, partitions[I], indices, views)) {
+			return false;
+		}
+		sortFacts<RelationType>(view, columnOrders[I]);
+		ranges[I] = {0, view.size()};
+		return true;
+	}
+
+	template <size_t... Is>
+	bool buildViews(const PartitionsType &partitions, index_sequence<Is...>) {
+		return ((buildView<Is>(partitions)) and ...);
+	}
+
+	// the first position in [lo, hi) at which the predicate fails, found by galloping from lo
+	template <typename PREDICATE>
+	static size_t gallop(size_t lo, size_t hi, PREDICATE predicate) {
+		if (lo == hi or not predicate(lo)) {
+			return lo;
+		}
+		size_t step = 1;
+		while (lo + step < hi and predicate(lo + step)) {
+			lo += step;
+			step *= 2;
+		}
+		hi = min(lo + step, hi);
+		lo++;
+		while (lo < hi) {
+			const size_t mid = lo + (hi - lo) / 2;
+			if (predicate(mid)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	size_t seek(const Occurrence &o, size_t lo, size_t hi) const {
+		return gallop(lo, hi, [this, &o](size_t p) { return (this->*o.compareKey)(p) < 0; });
+	}
+
+	size_t skip(const Occurrence &o, size_t lo, size_t hi) const {
+		return gallop(lo, hi, [this, &o](size_t p) { return (this->*o.compareKey)(p) <= 0; });
+	}
+
+	void join(size_t v) {
+		if (v == levels.size()) {
+			emit();
+			return;
+		}
+		const auto &level = levels[v];
+		const size_t m = level.size();
+		auto &position = positions[v];
+		auto &end = ends[v];
+		auto &runEnd = runEnds[v];
+		for (size_t k = 0; k < m; k++) {
+			tie(position[k], end[k]) = ranges[level[k].atom];
+		}
+		(this->*level[0].bindKey)(position[0]);
+		size_t agree = 1;
+		for (size_t i = 1;; i++) {
+			const size_t k = i % m;
+			if (agree == m) {
+				// every atom contains the value of the variable: narrow each atom to that value
+				const auto saved = ranges;
+				for (size_t j = 0; j < m; j++) {
+					runEnd[j] = skip(level[j], position[j], end[j]);
+					ranges[level[j].atom] = {position[j], runEnd[j]};
+				}
+				bool empty = false;
+				for (const auto &o : narrowings[v]) {
+					auto &range = ranges[o.atom];
+					range.first = seek(o, range.first, range.second);
+					range.second = skip(o, range.first, range.second);
+					empty = empty or range.first == range.second;
+				}
+				if (not empty) {
+					join(v + 1);
+				}
+				ranges = saved;
+				position[k] = runEnd[k];
+			} else {
+				position[k] = seek(level[k], position[k], end[k]);
+			}
+			if (position[k] == end[k]) {
+				break;
+			}
+			if (agree < m and (this->*level[k].compareKey)(position[k]) == 0) {
+				agree++;
+			} else {
+				(this->*level[k].bindKey)(position[k]);
+				agree = 1;
+			}
+		}
+		(this->*level[0].unbindKey)();
+	}
+
+	void emit() {
+		const size_t bound = boundExternals(rule, frame);
+		if (bindExternals(rule, frame)) {
+			derivedFacts.set.insert(ground<HeadRelationType>(rule.head, rule.layout.head, frame));
+		}
+		unbindExternals(rule, frame, bound);
+	}
+
+	const RULE_TYPE &rule;
+	const STATE_TYPE &state;
+	typename STATE_TYPE::IndicesType &indices;
+	RelationSet<HeadRelationType> &derivedFacts;
+	// the bindings of the variables of the rule
+	Frame frame;
+	// the distinct variables of the body, in order of first occurrence
+	vector<const void *> variables;
+	vector<vector<Occurrence>> occurrences;
+	vector<vector<Occurrence>> levels;
+	vector<vector<Occurrence>> narrowings;
+	array<vector<size_t>, N> columnOrders;
+	ViewsType views;
+	// the range of each atom's view that is consistent with the variables bound so far
+	array<Range, N> ranges;
+	vector<vector<size_t>> positions;
+	vector<vector<size_t>> ends;
+	vector<vector<size_t>> runEnds;
+};
+
+template <typename RULE_TYPE, typename STATE_TYPE>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyRule(
+	LeapfrogJoin,
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *
+)
+{
+	typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+	RelationSet<HeadRelationType> derivedFacts;
+	LeapfrogBodyJoin<RULE_TYPE, STATE_TYPE> bodyJoin{rule, state, indices, derivedFacts};
+	forEachDeltaVariant<typename RULE_TYPE::RuleType>(state, [&bodyJoin](const auto &partitions) {
+		bodyJoin.join(partitions);
+	});
+	return derivedFacts;
+}
+
+// Join a two-atom body by merging views of the atoms' facts sorted on their shared variables. An
+// atom whose shared variables are a prefix of its arguments is already in order in its set, other
+// atoms are re-sorted. Head facts are built directly from matching pairs of facts, without binding
+// variables. Other bodies, and rules with externals, are evaluated as IndexedJoin.
+struct MergeJoin {};
+
+template <typename RULE_TYPE, typename = void>
+struct hasExternals : false_type {};
+
+template <typename RULE_TYPE>
+struct hasExternals<RULE_TYPE, void_t<decltype(declval<RULE_TYPE>().externals)>> : true_type {};
+
+template <typename RULE_TYPE, typename STATE_TYPE>
+struct MergeBodyJoin {
+	typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+	typedef typename RULE_TYPE::RuleType::BodyRelations BodyRelations;
+	typedef typename RULE_TYPE::RuleType::BodyPartitionsType PartitionsType;
+	typedef typename RULE_TYPE::RuleType::BodyViewsType ViewsType;
+	typedef typename RULE_TYPE::BodyType BodyType;
+	typedef typename RULE_TYPE::HeadType HeadType;
+	typedef typename tuple_element<0, BodyRelations>::type::Ground LeftGround;
+	typedef typename tuple_element<1, BodyRelations>::type::Ground RightGround;
+	typedef typename HeadRelationType::Ground HeadGround;
+
+	MergeBodyJoin(const RULE_TYPE &rule, const STATE_TYPE &state, typename STATE_TYPE::IndicesType &indices,
+		RelationSet<HeadRelationType> &derivedFacts)
+		: rule(rule), state(state), indices(indices), derivedFacts(derivedFacts), frame(rule.layout.frame)
+	{
+		// no variable is bound in the frame, so its bound positions are constants
+		projected = boundPositions(rule.head, rule.layout.head, frame);
+		head = ground<HeadRelationType>(rule.head, rule.layout.head, frame, projected);
+		analyse();
+	}
+
+	// is every variable of the head bound by the body?
+	bool supported() const {
+		return projected == allPositions<HeadRelationType>();
+	}
+
+	void join(const PartitionsType &partitions) {
+		if (buildView<0>(partitions[0]) and buildView<1>(partitions[1])) {
+			merge();
+		}
+	}
+
+private:
+	// a variable shared by the two atoms, at its first column in each atom
+	struct Key {
+		size_t left;
+		size_t right;
+		int (*compare)(const LeftGround &, const RightGround &);
+	};
+
+	template <typename ATOM_TYPE, size_t C>
+	struct Argument {
+		typedef typename decay<typename tuple_element<C, ATOM_TYPE>::type>::type type;
+	};
+
+	template <size_t I>
+	struct Atom {
+		typedef typename decay<typename tuple_element<I, BodyType>::type>::type type;
+	};
+
+	template <typename GROUND_TYPE, size_t A, size_t B>
+	static bool equalColumns(const GROUND_TYPE &fact) {
+		return get<A>(fact) == get<B>(fact);
+	}
+
+	template <size_t A, size_t B>
+	static int compareKey(const LeftGround &left, const RightGround &right) {
+		return get<A>(left) < get<B>(right) ? -1 : (get<B>(right) < get<A>(left) ? 1 : 0);
+	}
+
+	template <size_t H, size_t I, size_t C>
+	static void project(const LeftGround &left, const RightGround &right, HeadGround &fact) {
+		get<H>(fact) = get<C>(get<I>(tie(left, right)));
+	}
+
+	template <typename A, typename B>
+	static constexpr bool sameVariableType() {
+		return isVariable<A>::value and is_same<A, B>::value;
+	}
+
+	// a variable repeated within an atom filters its facts
+	template <size_t I, size_t A, size_t B>
+	void analyseRepeat() {
+		typedef typename Atom<I>::type AtomType;
+		if constexpr (A < B and sameVariableType<typename Argument<AtomType, A>::type, typename Argument<AtomType, B>::type>()) {
+			const auto &atom = get<I>(rule.body);
+			if (not (repeated[I] & (size_t{1} << A)) and get<A>(atom) == get<B>(atom) and not (repeated[I] & (size_t{1} << B))) {
+				repeated[I] |= size_t{1} << B;
+				get<I>(filters).push_back(&equalColumns<typename tuple_element<I, BodyRelations>::type::Ground, A, B>);
+			}
+		}
+	}
+
+	template <size_t I, size_t A, size_t... Bs>
+	void analyseRepeatsOf(index_sequence<Bs...>) {
+		((analyseRepeat<I, A, Bs>()), ...);
+	}
+
+	template <size_t I, size_t... As>
+	void analyseRepeats(index_sequence<As...> columns) {
+		((analyseRepeatsOf<I, As>(columns)), ...);
+	}
+
+	template <size_t A, size_t B>
+	void analyseKey() {
+		if constexpr (sameVariableType<typename Argument<typename Atom<0>::type, A>::type, typename Argument<typename Atom<1>::type, B>::type>()) {
+			if (not (repeated[0] & (size_t{1} << A)) and not (repeated[1] & (size_t{1} << B)) and
+				get<A>(get<0>(rule.body)) == get<B>(get<1>(rule.body))) {
+				keys.push_back({A, B, &compareKey<A, B>});
+			}
+		}
+	}
+
+	template <size_t A, size_t... Bs>
+	void analyseKeysOf(index_sequence<Bs...>) {
+		((analyseKey<A, Bs>()), ...);
+	}
+
+	template <size_t... As, typename RIGHT_COLUMNS>
+	void analyseKeys(index_sequence<As...>, RIGHT_COLUMNS rightColumns) {
+		((analyseKeysOf<As>(rightColumns)), ...);
+	}
+
+	template <size_t H, size_t I, size_t C>
+	void analyseProjection() {
+		if constexpr (sameVariableType<typename Argument<HeadType, H>::type, typename Argument<typename Atom<I>::type, C>::type>()) {
+			if (not (projected & (size_t{1} << H)) and get<H>(rule.head) == get<C>(get<I>(rule.body))) {
+				projected |= size_t{1} << H;
+				projections.push_back(&project<H, I, C>);
+			}
+		}
+	}
+
+	template <size_t H, size_t I, size_t... Cs>
+	void analyseProjectionsOf(index_sequence<Cs...>) {
+		((analyseProjection<H, I, Cs>()), ...);
+	}
+
+	template <size_t... Hs>
+	void analyseProjections(index_sequence<Hs...>) {
+		((analyseProjectionsOf<Hs, 0>(make_index_sequence<tuple_size<LeftGround>::value>{})), ...);
+		((analyseProjectionsOf<Hs, 1>(make_index_sequence<tuple_size<RightGround>::value>{})), ...);
+	}
+
+	// are the key columns of an atom, in key order, a prefix of its arguments other than constants?
+	static bool aligned(const vector<Key> &keys, size_t Key::*column, size_t constants) {
+		size_t next = 0;
+		for (const auto &key : keys) {
+			while (constants & (size_t{1} << next)) {
+				next++;
+			}
+			if (key.*column != next++) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t alignment(const vector<Key> &order) const {
+		return aligned(order, &Key::left, constants[0]) + aligned(order, &Key::right, constants[1]);
+	}
+
+	void analyse() {
+		const auto leftColumns = make_index_sequence<tuple_size<LeftGround>::value>{};
+		const auto rightColumns = make_index_sequence<tuple_size<RightGround>::value>{};
+		analyseRepeats<0>(leftColumns);
+		analyseRepeats<1>(rightColumns);
+		analyseKeys(leftColumns, rightColumns);
+		analyseProjections(make_index_sequence<tuple_size<HeadGround>::value>{});
+		constants = {{boundPositions(get<0>(rule.body), get<0>(rule.layout.body), frame),
+			boundPositions(get<1>(rule.body), get<1>(rule.layout.body), frame)}};
+		// keys are in left column order, unless right column order leaves fewer atoms to re-sort
+		auto rightOrder = keys;
+		sort(rightOrder.begin(), rightOrder.end(), [](const Key &a, const Key &b) { return a.right < b.right; });
+		if (alignment(rightOrder) > alignment(keys)) {
+			keys = rightOrder;
+		}
+		// facts of unordered relations must always be sorted here
+		sorted = {{tuple_element<0, BodyRelations>::type::Storage::ordered and aligned(keys, &Key::left, constants[0]),
+			tuple_element<1, BodyRelations>::type::Storage::ordered and aligned(keys, &Key::right, constants[1])}};
+		for (const auto &key : keys) {
+			keyColumns[0].push_back(key.left);
+			keyColumns[1].push_back(key.right);
+		}
+	}
+
+	// a view of the facts of an atom that match its constants and repeated variables, sorted on its key columns
+	template <size_t I>
+	bool buildView(unsigned partitions) {
+		typedef typename tuple_element<I, BodyRelations>::type RelationType;
+		auto &view = get<I>(views);
+		view.clear();
+		for (Partition partition : {Stable, Delta}) {
+			if (partitions & partition) {
+				const size_t middle = view.size();
+				selectPartition<I>(rule, frame, state, partition, indices, views);
+				const auto &atomFilters = get<I>(filters);
+				view.erase(remove_if(view.begin() + middle, view.end(), [&atomFilters](const auto &it) {
+					return any_of(atomFilters.begin(), atomFilters.end(), [&it](const auto &filter) { return not filter(*it); });
+				}), view.end());
+				if (sorted[I] and middle > 0) {
+					inplace_merge(view.begin(), view.begin() + middle, view.end(), [](const auto &a, const auto &b) {
+						return *a < *b;
+					});
+				}
+			}
+		}
+		if (not sorted[I]) {
+			sortFacts<RelationType>(view, keyColumns[I]);
+		}
+		return not view.empty();
+	}
+
+	int compareKeys(const LeftGround &left, const RightGround &right) const {
+		for (const auto &key : keys) {
+			const int c = key.compare(left, right);
+			if (c) {
+				return c;
+			}
+		}
+		return 0;
+	}
+
+	void merge() {
+		const auto &left = get<0>(views);
+		const auto &right = get<1>(views);
+		size_t i = 0;
+		size_t j = 0;
+		while (i < left.size() and j < right.size()) {
+			const int c = compareKeys(*left[i], *right[j]);
+			if (c < 0) {
+				i++;
+			} else if (c > 0) {
+				j++;
+			} else {
+				// every pair of facts in the matching runs joins
+				size_t leftEnd = i + 1;
+				while (leftEnd < left.size() and compareKeys(*left[leftEnd], *right[j]) == 0) {
+					leftEnd++;
+				}
+				size_t rightEnd = j + 1;
+				while (rightEnd < right.size() and compareKeys(*left[i], *right[rightEnd]) == 0) {
+					rightEnd++;
+				}
+				for (; i < leftEnd; i++) {
+					for (size_t k = j; k < rightEnd; k++) {
+						emit(*left[i], *right[k]);
+					}
+				}
+				j = rightEnd;
+			}
+		}
+	}
+
+	void emit(const LeftGround &left, const RightGround &right) {
+		HeadGround fact = head;
+		for (const auto &projection : projections) {
+			projection(left, right, fact);
+		}
+		derivedFacts.set.insert(fact);
+	}
+
+	const RULE_TYPE &rule;
+	const STATE_TYPE &state;
+	typename STATE_TYPE::IndicesType &indices;
+	RelationSet<HeadRelationType> &derivedFacts;
+	// no variable is bound in the frame: the join builds head facts directly from body facts
+	Frame frame;
+	vector<Key> keys;
+	array<vector<size_t>, 2> keyColumns;
+	// columns of each atom that repeat an earlier variable of the atom
+	array<size_t, 2> repeated{};
+	tuple<vector<bool (*)(const LeftGround &)>, vector<bool (*)(const RightGround &)>> filters;
+	array<size_t, 2> constants;
+	// do the sets of each atom already order its facts on the key columns?
+	array<bool, 2> sorted;
+	ViewsType views;
+	// the head with its constants ground, and the head positions that are constants or projected from the body
+	HeadGround head;
+	size_t projected;
+	vector<void (*)(const LeftGround &, const RightGround &, HeadGround &)> projections;
+};
+
+template <typename RULE_TYPE, typename STATE_TYPE>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyRule(
+	MergeJoin,
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *pool
+)
+{
+	if constexpr (tuple_size<typename RULE_TYPE::RuleType::BodyRelations>::value != 2 or hasExternals<RULE_TYPE>::value) {
+		return applyIndexedJoin(IndexedJoin{}, rule, state, indices, pool);
+	} else {
+		typedef typename RULE_TYPE::RuleType::HeadRelationType HeadRelationType;
+		RelationSet<HeadRelationType> derivedFacts;
+		MergeBodyJoin<RULE_TYPE, STATE_TYPE> bodyJoin{rule, state, indices, derivedFacts};
+		if (not bodyJoin.supported()) {
+			return applyIndexedJoin(IndexedJoin{}, rule, state, indices, pool);
+		}
+		forEachDeltaVariant<typename RULE_TYPE::RuleType>(state, [&bodyJoin](const auto &partitions) {
+			bodyJoin.join(partitions);
+		});
+		return derivedFacts;
+	}
+}
+
+// Rules P(xs..., z) :- L(xs..., y), R(y, z) over bit-matrix relations of one domain, with distinct
+// variables and body atoms in either order, compose the matrices of L and R whatever the strategy
+
+template <typename RULE_TYPE, size_t L, size_t R>
+constexpr bool composable()
+{
+	typedef typename RULE_TYPE::RuleType RuleType;
+	typedef typename RuleType::BodyRelations BodyRelations;
+	if constexpr (tuple_size<BodyRelations>::value != 2 or hasExternals<RULE_TYPE>::value) {
+		return false;
+	} else {
+		typedef typename RuleType::HeadRelationType::TrackedSet HeadSet;
+		typedef typename tuple_element<L, BodyRelations>::type::TrackedSet LeftSet;
+		typedef typename tuple_element<R, BodyRelations>::type::TrackedSet RightSet;
+		if constexpr (isBitMatrixSet<HeadSet>::value and isBitMatrixSet<RightSet>::value) {
+			return is_same<HeadSet, LeftSet>::value and RightSet::arity == 2 and RightSet::domainSize == HeadSet::domainSize;
+		} else {
+			return false;
+		}
+	}
+}
+
+// do the variables of a rule have the pattern of a composition?
+template <size_t L, size_t R, typename RULE_TYPE>
+bool composes(const RULE_TYPE &rule)
+{
+	auto variables = [](const auto &atom) {
+		return apply([](const auto &... args) { return vector<const void *>{variableOf(args)...}; }, atom);
+	};
+	const auto head = variables(rule.head);
+	const auto left = variables(get<L>(rule.body));
+	const auto right = variables(get<R>(rule.body));
+	const size_t last = left.size() - 1;
+	auto distinct = left;
+	distinct.push_back(right[1]);
+	sort(distinct.begin(), distinct.end());
+	if (distinct.front() == nullptr or adjacent_find(distinct.begin(), distinct.end()) != distinct.end()) {
+		return false;
+	}
+	return equal(head.begin(), head.begin() + last, left.begin()) and head[last] == right[1] and right[0] == left[last];
+}
+
+template <size_t L, size_t R, typename RULE_TYPE, typename STATE_TYPE>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> applyComposition(const RULE_TYPE &, const STATE_TYPE &state)
+{
+	typedef typename RULE_TYPE::RuleType RuleType;
+	typedef typename tuple_element<L, typename RuleType::BodyRelations>::type LeftRelation;
+	typedef typename tuple_element<R, typename RuleType::BodyRelations>::type RightRelation;
+	RelationSet<typename RuleType::HeadRelationType> derivedFacts;
+	forEachDeltaVariant<RuleType>(state, [&state, &derivedFacts](const auto &partitions) {
+		for (Partition left : {Stable, Delta}) {
+			for (Partition right : {Stable, Delta}) {
+				if ((partitions[L] & left) and (partitions[R] & right)) {
+					derivedFacts.set.compose(state.template partition<LeftRelation>(left), state.template partition<RightRelation>(right));
+				}
+			}
+		}
+	});
+	return derivedFacts;
+}
+
+// Derive the facts of a rule with a strategy, unless the rule is a composition
+template <typename EVALUATION, typename RULE_TYPE, typename STATE_TYPE>
+RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> deriveFacts(
+	EVALUATION evaluation,
+	const RULE_TYPE &rule,
+	const STATE_TYPE &state,
+	typename STATE_TYPE::IndicesType &indices,
+	ThreadPool *pool = nullptr
+)
+{
+	if constexpr (isStaticRule<RULE_TYPE>::value) {
+		// the join of a rule over placeholders is planned when it is compiled, whatever the strategy
+		RelationSet<typename RULE_TYPE::RuleType::HeadRelationType> derivedFacts;
+		applyStaticJoin(rule, state, indices, derivedFacts);
+		return derivedFacts;
+	} else {
+		if constexpr (composable<RULE_TYPE, 0, 1>()) {
+			if (composes<0, 1>(rule)) {
+				return applyComposition<0, 1>(rule, state);
+			}
+		}
+		if constexpr (composable<RULE_TYPE, 1, 0>()) {
+			if (composes<1, 0>(rule)) {
+				return applyComposition<1, 0>(rule, state);
+			}
+		}
+		return applyRule(evaluation, rule, state, indices, pool);
+	}
+}
+
+// A rule that is evaluated with its own strategy, rather than the strategy passed to fixPoint
+template <typename EVALUATION, typename RULE_INSTANCE_TYPE>
+struct EvaluatedRuleInstance : RULE_INSTANCE_TYPE {
+	typedef EVALUATION Evaluation;
+};
+
+/**
+ * @brief select the evaluation strategy of a rule
+ * 
+ * @tparam EVALUATION the evaluation strategy for the rule body
+ * @param rule 
+ * @return EvaluatedRuleInstance<EVALUATION, RULE_INSTANCE_TYPE> 
+ */
+template <typename EVALUATION, typename RULE_INSTANCE_TYPE>
+EvaluatedRuleInstance<EVALUATION, RULE_INSTANCE_TYPE> evaluate(const RULE_INSTANCE_TYPE &rule) {
+	return EvaluatedRuleInstance<EVALUATION, RULE_INSTANCE_TYPE>{rule};
+}
+
+template <typename RULE_TYPE, typename DEFAULT_EVALUATION>
+struct RuleEvaluation {
+	typedef DEFAULT_EVALUATION type;
+};
+
+template <typename EVALUATION, typename RULE_INSTANCE_TYPE, typename DEFAULT_EVALUATION>
+struct RuleEvaluation<EvaluatedRuleInstance<EVALUATION, RULE_INSTANCE_TYPE>, DEFAULT_EVALUATION> {
+	typedef EVALUATION type;
+};
+
+template <typename RELATION_TYPE>
+void merge(RelationSet<RELATION_TYPE>& s1, RelationSet<RELATION_TYPE>&s2)
+{
+	s2.set.merge(s1.set);
+}
+
+template <typename RELATION_TYPE>
+void merge(RelationSet<RELATION_TYPE>& s1, RelationSet<RELATION_TYPE>&s2, ThreadPool &pool)
+{
+	mergeSet(s2.set, s1.set, pool);
+}
+
+template<size_t I, typename STATE_RELATIONS_TYPE>
+void merge(STATE_RELATIONS_TYPE& newState, STATE_RELATIONS_TYPE& state) {
+	auto& newSet = get<I>(newState.stateRelations);
+	auto& set = get<I>(state.stateRelations);
+	merge(newSet, set);
+}
+
+template <size_t ... Is, typename STATE_RELATIONS_TYPE>
+void merge(STATE_RELATIONS_TYPE& newState, STATE_RELATIONS_TYPE& state, index_sequence<Is...>) {
+	((merge<Is>(newState, state)), ...);
+}
+
+template<typename ... RELATIONs>
+void merge(State<RELATIONs...> &newState, State<RELATIONs...> &state) {
+	typedef typename State<RELATIONs...>::StateRelationsType StateRelationsType;
+	return merge(newState, state, make_index_sequence<tuple_size<StateRelationsType>::value>{});
+}
+
+// Start the next iteration of semi-naive evaluation: the delta facts become stable, and the
+// newly derived facts that are not already stable become the delta
+template <typename RELATION_TYPE>
+void advance(RelationSet<RELATION_TYPE>& newFacts, RelationSet<RELATION_TYPE>& stable, RelationSet<RELATION_TYPE>& delta)
+{
+	merge(delta, stable);
+	auto& facts = newFacts.set;
+	flush(facts);
+	subtract(facts, stable.set);
+	swap(delta.set, facts);
+}
+
+template <typename RELATION_TYPE>
+void advance(RelationSet<RELATION_TYPE>& newFacts, RelationSet<RELATION_TYPE>& stable, RelationSet<RELATION_TYPE>& delta, ThreadPool &pool)
+{
+	merge(delta, stable, pool);
+	auto& facts = newFacts.set;
+	flush(facts);
+	subtract(facts, stable.set, pool);
+	swap(delta.set, facts);
+}
+
+template <size_t ... Is, typename ... RELATIONs>
+void advance(State<RELATIONs...> &newState, State<RELATIONs...> &state, index_sequence<Is...>) {
+	((advance(get<Is>(newState.stateRelations), get<Is>(state.stateRelations), get<Is>(state.deltaRelations))), ...);
+}
+
+template<typename ... RELATIONs>
+void advance(State<RELATIONs...> &newState, State<RELATIONs...> &state) {
+	advance(newState, state, make_index_sequence<sizeof...(RELATIONs)>{});
+}
+
+// Advance the relations of a state at once, on a pool
+template <size_t ... Is, typename ... RELATIONs>
+void advance(State<RELATIONs...> &newState, State<RELATIONs...> &state, ThreadPool &pool, index_sequence<Is...>) {
+	pool.run({[&newState, &state, &pool]() {
+		advance(get<Is>(newState.stateRelations), get<Is>(state.stateRelations), get<Is>(state.deltaRelations), pool);
+	}...});
+}
+
+template<typename ... RELATIONs>
+void advance(State<RELATIONs...> &newState, State<RELATIONs...> &state, ThreadPool &pool) {
+	advance(newState, state, pool, make_index_sequence<sizeof...(RELATIONs)>{});
+}
+
+template <typename RELATION_TYPE, typename ... RELATIONs>
+void assign(RelationSet<RELATION_TYPE>&& facts, State<RELATIONs...> &state) {
+	typedef RelationSet<RELATION_TYPE> SetType;
+	merge(facts, get<SetType>(state.stateRelations));
+}
+
+// Merge the facts derived by the rules whose head is a relation into a state, in rule order
+template <typename RELATION_TYPE, typename DERIVED_FACTS_TYPE, size_t... Is, typename ... RELATIONs>
+void assign(DERIVED_FACTS_TYPE &derivedFacts, State<RELATIONs...> &state, ThreadPool &pool, index_sequence<Is...>) {
+	auto &facts = get<RelationSet<RELATION_TYPE>>(state.stateRelations);
+	([&derivedFacts, &facts, &pool]() {
+		if constexpr (is_same<typename tuple_element<Is, DERIVED_FACTS_TYPE>::type, RelationSet<RELATION_TYPE>>::value) {
+			merge(get<Is>(derivedFacts), facts, pool);
+		}
+	}(), ...);
+}
+
+template <typename ... RULE_TYPEs>
+struct RuleSet {
+	tuple<RULE_TYPEs...> rules;
+};
+
+template <typename ... RULE_TYPEs>
+RuleSet<RULE_TYPEs...> ruleset(RULE_TYPEs&&... r) {
+	return RuleSet<RULE_TYPEs...>{{r...}};
+}
+
+// Derive the facts of a rule into the next state: rules over placeholders insert their facts into
+// the set of their head relation directly, other rules into a set of their own that is then merged
+template <typename EVALUATION, typename RULE_TYPE, typename ... RELATIONs>
+void deriveInto(
+	const RULE_TYPE &rule,
+	const State<RELATIONs...> &state,
+	State<RELATIONs...> &newState,
+	typename State<RELATIONs...>::IndicesType &indices
+) {
+	if constexpr (isStaticRule<RULE_TYPE>::value) {
+		applyStaticJoin(rule, state, indices, get<RelationSet<typename RULE_TYPE::RuleType::HeadRelationType>>(newState.stateRelations));
+	} else {
+		assign(deriveFacts(typename RuleEvaluation<RULE_TYPE, EVALUATION>::type{}, rule, state, indices), newState);
+	}
+}
+
+template <typename EVALUATION, typename ... RULE_TYPEs, typename... RELATIONs>
+void applyRules(
+	const RuleSet<RULE_TYPEs...> &ruleSet,
+	const State<RELATIONs...> &state,
+	State<RELATIONs...> &newState
+) {
+	// indices are shared by all rules in this iteration, and released in bulk with its arena
+	pmr::monotonic_buffer_resource arena;
+	typename State<RELATIONs...>::IndicesType indices{RelationIndices<RELATIONs>{&arena}...};
+	apply([&state, &newState, &indices](auto &&... args) { 
+		((deriveInto<EVALUATION>(args, state, newState, indices)), ...);
+	}, ruleSet.rules);
+}
+
+template <typename EVALUATION, typename ... RULE_TYPEs, typename... RELATIONs, size_t... Is>
+void applyRules(
+	const RuleSet<RULE_TYPEs...> &ruleSet,
+	const State<RELATIONs...> &state,
+	State<RELATIONs...> &newState,
+	ThreadPool &pool,
+	index_sequence<Is...>
+) {
+	typedef typename State<RELATIONs...>::IndicesType IndicesType;
+	tuple<RelationSet<typename decay<RULE_TYPEs>::type::RuleType::HeadRelationType>...> derivedFacts;
+	const array<function<void(IndicesType &)>, sizeof...(Is)> rules{{
+		[&ruleSet, &state, &derivedFacts, &pool](IndicesType &indices) {
+			get<Is>(derivedFacts) = deriveFacts(typename RuleEvaluation<typename decay<RULE_TYPEs>::type, EVALUATION>::type{},
+				get<Is>(ruleSet.rules), state, indices, &pool);
+		}...
+	}};
+	vector<function<void()>> tasks;
+	for (const auto &rule : rules) {
+		tasks.push_back([&rule]() {
+			// each rule builds its own indices, in its own arena
+			pmr::monotonic_buffer_resource arena;
+			IndicesType indices{RelationIndices<RELATIONs>{&arena}...};
+			rule(indices);
+		});
+	}
+	pool.run(tasks);
+	// the facts of each rule are merged in rule order, as in sequential evaluation, and the facts of
+	// each relation at once
+	pool.run({[&derivedFacts, &newState, &pool]() {
+		assign<RELATIONs>(derivedFacts, newState, pool, index_sequence<Is...>{});
+	}...});
+}
+
+// Apply the rules of a set on a thread pool, evaluating them at once
+template <typename EVALUATION, typename ... RULE_TYPEs, typename... RELATIONs>
+void applyRules(
+	const RuleSet<RULE_TYPEs...> &ruleSet,
+	const State<RELATIONs...> &state,
+	State<RELATIONs...> &newState,
+	ThreadPool &pool
+) {
+	applyRules<EVALUATION>(ruleSet, state, newState, pool, make_index_sequence<sizeof...(RULE_TYPEs)>{});
+}
+
+template <typename EVALUATION = NestedLoopJoin, typename ... RULE_TYPEs, typename... RELATIONs>
+void applyRuleSet(
+	typename State<RELATIONs...>::StateSizesType& stateSizeDelta,
+	const RuleSet<RULE_TYPEs...> &ruleSet, 
+	State<RELATIONs...> &state,
+	ThreadPool *pool = nullptr
+) {
+	// compute new state
+	State<RELATIONs...> newState;
+	if (pool) {
+		applyRules<EVALUATION>(ruleSet, state, newState, *pool);
+	} else {
+		applyRules<EVALUATION>(ruleSet, state, newState);
+	}
+	// the unseen new facts are the delta of the next iteration
+	if (pool) {
+		advance(newState, state, *pool);
+	} else {
+		advance(newState, state);
+	}
+	state.sizes(stateSizeDelta, Delta);
+}
+
+// Apply the rules of a set to a state until no new facts are derived
+template <typename EVALUATION, typename ... RULE_TYPEs, typename... RELATIONs>
+void iterate(const RuleSet<RULE_TYPEs...> &ruleSet, State<RELATIONs...> &state, ThreadPool *pool) {
+	typedef State<RELATIONs...> StateType;
+	// initially every fact is unseen
+	swap(state.stateRelations, state.deltaRelations);
+	typename State<RELATIONs...>::StateSizesType stateSizeDelta;
+	do {
+		applyRuleSet<EVALUATION>(stateSizeDelta, ruleSet, state, pool);
+	} while (StateType::size(stateSizeDelta) > 0);
+}
+
+/**
+ * @brief compute the least fix point of a set of rules in place, starting from the facts in a state
+ * that is moved in, so that the facts are not copied
+ * 
+ * @tparam EVALUATION the evaluation strategy for rule bodies (NestedLoopJoin, CartesianJoin, IndexedJoin, HashJoin, LeapfrogJoin or MergeJoin)
+ * @param ruleSet 
+ * @param state 
+ * @return State<RELATIONs...> 
+ */
+template <typename EVALUATION = NestedLoopJoin, typename ... RULE_TYPEs, typename... RELATIONs>
+State<RELATIONs...> fixPoint(const RuleSet<RULE_TYPEs...> &ruleSet, State<RELATIONs...> &&state) {
+	iterate<EVALUATION>(ruleSet, state, nullptr);
+	return move(state);
+}
+
+/**
+ * @brief compute the least fix point of a set of rules in place, evaluating the rules of each
+ * iteration concurrently on a thread pool
+ * 
+ * @tparam EVALUATION the evaluation strategy for rule bodies
+ * @param ruleSet 
+ * @param state 
+ * @param pool 
+ * @return State<RELATIONs...> 
+ */
+template <typename EVALUATION = NestedLoopJoin, typename ... RULE_TYPEs, typename... RELATIONs>
+State<RELATIONs...> fixPoint(const RuleSet<RULE_TYPEs...> &ruleSet, State<RELATIONs...> &&state, ThreadPool &pool) {
+	iterate<EVALUATION>(ruleSet, state, &pool);
+	return move(state);
+}
+
+template <typename EVALUATION = NestedLoopJoin, typename ... RULE_TYPEs, typename... RELATIONs>
+State<RELATIONs...> fixPoint(const RuleSet<RULE_TYPEs...> &ruleSet, const State<RELATIONs...> &state, ThreadPool &pool) {
+	return fixPoint<EVALUATION>(ruleSet, State<RELATIONs...>{state}, pool);
+}
+
+/**
+ * @brief compute the least fix point of a set of rules, starting from a copy of the facts in a state
+ * 
+ * @tparam EVALUATION the evaluation strategy for rule bodies (NestedLoopJoin, CartesianJoin, IndexedJoin, HashJoin, LeapfrogJoin or MergeJoin)
+ * @param ruleSet 
+ * @param state 
+ * @return State<RELATIONs...> 
+ */
+template <typename EVALUATION = NestedLoopJoin, typename ... RULE_TYPEs, typename... RELATIONs>
+State<RELATIONs...> fixPoint(const RuleSet<RULE_TYPEs...> &ruleSet, const State<RELATIONs...> &state) {
+	return fixPoint<EVALUATION>(ruleSet, State<RELATIONs...>{state});
 }
 
 } // namespace datalog
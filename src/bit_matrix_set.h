@@ -0,0 +1,439 @@
+#ifndef BIT_MATRIX_SET_H
+#define BIT_MATRIX_SET_H
+
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief A set of tuples over a small domain, stored as a dense bit matrix: one bit per possible
+ * tuple. The elements of the tuples are integers or enums whose values are below DOMAIN_SIZE.
+ *
+ * The tuples that share all but their last element form a row of bits, padded to whole words, and
+ * rows are in lexicographic order, so the bits of the set are in the order of its tuples. Union,
+ * difference, intersection and composition work a word (64 tuples) at a time.
+ *
+ * Iterators dereference to copies of the tuples. Inserting a tuple with an element outside the
+ * domain throws out_of_range; finding such a tuple, or looking up such a prefix, finds nothing.
+ *
+ * @tparam DOMAIN_SIZE is the number of values of each element
+ * @tparam Ts are the types of the elements of the tuples
+ */
+template <size_t DOMAIN_SIZE, typename... Ts>
+class BitMatrixSet
+{
+public:
+    typedef tuple<Ts...> Row;
+    typedef Row value_type;
+    typedef value_type key_type;
+    typedef size_t size_type;
+
+    static constexpr size_t domainSize = DOMAIN_SIZE;
+    static constexpr size_t arity = sizeof...(Ts);
+    static constexpr size_t rowWords = (DOMAIN_SIZE + 63) / 64;
+    static constexpr size_t rowBits = rowWords * 64;
+
+    class const_iterator
+    {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef typename BitMatrixSet::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef value_type reference;
+
+        // holds a copy of a tuple, so that it-> works
+        struct ArrowProxy
+        {
+            value_type value;
+            const value_type *operator->() const
+            {
+                return &value;
+            }
+        };
+
+        const_iterator() = default;
+        const_iterator(const BitMatrixSet *set, size_t bit) : set(set), bit(bit) {}
+
+        value_type operator*() const
+        {
+            return set->decode(bit);
+        }
+
+        ArrowProxy operator->() const
+        {
+            return {**this};
+        }
+
+        const_iterator &operator++()
+        {
+            bit = set->nextBit(bit + 1);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return bit == other.bit and set == other.set;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return not (*this == other);
+        }
+
+    private:
+        const BitMatrixSet *set = nullptr;
+        size_t bit = 0;
+    };
+    typedef const_iterator iterator;
+
+    BitMatrixSet() = default;
+
+    BitMatrixSet(initializer_list<value_type> values)
+    {
+        for (const auto &value : values) {
+            insert(value);
+        }
+    }
+
+    const_iterator begin() const
+    {
+        return {this, nextBit(0)};
+    }
+
+    const_iterator end() const
+    {
+        return {this, words.size() * 64};
+    }
+
+    size_type size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    // the words are allocated by the first insert
+    void clear()
+    {
+        words.clear();
+        count = 0;
+    }
+
+    /**
+     * @brief add a tuple
+     *
+     * @return the position of the tuple in the set, and whether it was inserted
+     */
+    pair<const_iterator, bool> insert(const value_type &value)
+    {
+        allocate();
+        const size_t bit = encode(value);
+        uint64_t &word = words[bit / 64];
+        const uint64_t mask = uint64_t{1} << (bit % 64);
+        const bool inserted = not (word & mask);
+        word |= mask;
+        count += inserted;
+        return {const_iterator{this, bit}, inserted};
+    }
+
+    const_iterator find(const value_type &value) const
+    {
+        if (not inDomain(value, arity)) {
+            return end();
+        }
+        const size_t bit = encode(value);
+        return test(bit) ? const_iterator{this, bit} : end();
+    }
+
+    /**
+     * @brief the tuples that start with a prefix, which has the first elements of a tuple in key
+     * and their number in length (such as Relation::Prefix)
+     */
+    template <typename PREFIX>
+    pair<const_iterator, const_iterator> equal_range(const PREFIX &prefix) const
+    {
+        if (words.empty() or not inDomain(prefix.key, prefix.length)) {
+            return {end(), end()};
+        }
+        size_t first;
+        size_t last;
+        if (prefix.length == arity) {
+            first = encode(prefix.key);
+            last = first + 1;
+        } else {
+            // the prefix fixes a block of consecutive rows
+            size_t rows = 1;
+            for (size_t i = prefix.length; i + 1 < arity; i++) {
+                rows *= DOMAIN_SIZE;
+            }
+            first = rowOf(prefix.key, prefix.length) * rows * rowBits;
+            last = first + rows * rowBits;
+        }
+        return {const_iterator{this, nextBit(first)}, const_iterator{this, nextBit(last)}};
+    }
+
+    /**
+     * @brief add the tuples of another set that are not in this set to this set, a word at a time.
+     * Unlike std::set::merge the other set is left empty.
+     *
+     * @param other
+     */
+    void merge(BitMatrixSet &other)
+    {
+        if (other.empty()) {
+            return;
+        }
+        if (words.empty()) {
+            swap(words, other.words);
+            count = other.count;
+        } else {
+            for (size_t i = 0; i < words.size(); i++) {
+                words[i] |= other.words[i];
+            }
+            recount();
+        }
+        other.clear();
+    }
+
+    /**
+     * @brief remove the tuples of this set that are in another set, a word at a time
+     *
+     * @param other
+     */
+    void subtract(const BitMatrixSet &other)
+    {
+        if (empty() or other.empty()) {
+            return;
+        }
+        for (size_t i = 0; i < words.size(); i++) {
+            words[i] &= ~other.words[i];
+        }
+        recount();
+    }
+
+    /**
+     * @brief keep only the tuples of this set that are in another set, a word at a time
+     *
+     * @param other
+     */
+    void intersect(const BitMatrixSet &other)
+    {
+        if (other.empty()) {
+            clear();
+            return;
+        }
+        for (size_t i = 0; i < words.size(); i++) {
+            words[i] &= other.words[i];
+        }
+        recount();
+    }
+
+    /**
+     * @brief add the composition of two sets to this set: the tuples (xs..., z) such that
+     * (xs..., y) is in left and (y, z) is in right. Each tuple of left adds a row of right to a row
+     * of this set, a word at a time.
+     *
+     * @param left a set of tuples of the arity of this set
+     * @param right a set of pairs
+     */
+    template <typename... Us>
+    void compose(const BitMatrixSet &left, const BitMatrixSet<DOMAIN_SIZE, Us...> &right)
+    {
+        static_assert(sizeof...(Us) == 2, "only a relation of pairs composes with other relations");
+        if (left.empty() or right.empty()) {
+            return;
+        }
+        allocate();
+        const size_t rows = left.words.size() / rowWords;
+        for (size_t row = 0; row < rows; row++) {
+            uint64_t *target = &words[row * rowWords];
+            const uint64_t *source = &left.words[row * rowWords];
+            for (size_t w = 0; w < rowWords; w++) {
+                for (uint64_t bits = source[w]; bits; bits &= bits - 1) {
+                    const uint64_t *image = right.row(w * 64 + lowestBit(bits));
+                    for (size_t i = 0; i < rowWords; i++) {
+                        target[i] |= image[i];
+                    }
+                }
+            }
+        }
+        recount();
+    }
+
+    /**
+     * @brief the words of a row of bits (the words of the set must be allocated)
+     */
+    const uint64_t *row(size_t r) const
+    {
+        return &words[r * rowWords];
+    }
+
+    bool operator==(const BitMatrixSet &other) const
+    {
+        if (count != other.count) {
+            return false;
+        }
+        return count == 0 or words == other.words;
+    }
+
+    bool operator!=(const BitMatrixSet &other) const
+    {
+        return not (*this == other);
+    }
+
+private:
+    static size_t bitCount(uint64_t word)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(word);
+#else
+        size_t n = 0;
+        for (; word; word &= word - 1) {
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    static size_t lowestBit(uint64_t word)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(word);
+#else
+        size_t i = 0;
+        while (not (word & 1)) {
+            word >>= 1;
+            i++;
+        }
+        return i;
+#endif
+    }
+
+    void allocate()
+    {
+        if (words.empty()) {
+            size_t rows = 1;
+            for (size_t i = 1; i < arity; i++) {
+                rows *= DOMAIN_SIZE;
+            }
+            words.assign(rows * rowWords, 0);
+        }
+    }
+
+    void recount()
+    {
+        count = 0;
+        for (uint64_t word : words) {
+            count += bitCount(word);
+        }
+    }
+
+    bool test(size_t bit) const
+    {
+        return bit / 64 < words.size() and (words[bit / 64] >> (bit % 64) & 1);
+    }
+
+    // the position of the first set bit at or after a bit, or the end
+    size_t nextBit(size_t bit) const
+    {
+        const size_t end = words.size() * 64;
+        if (bit >= end) {
+            return end;
+        }
+        size_t w = bit / 64;
+        uint64_t word = words[w] & (~uint64_t{0} << (bit % 64));
+        while (not word) {
+            if (++w == words.size()) {
+                return end;
+            }
+            word = words[w];
+        }
+        return w * 64 + lowestBit(word);
+    }
+
+    template <size_t I>
+    static size_t element(const Row &row)
+    {
+        const size_t value = static_cast<size_t>(get<I>(row));
+        if (value >= DOMAIN_SIZE) {
+            throw out_of_range("BitMatrixSet: element outside the domain");
+        }
+        return value;
+    }
+
+    template <size_t... Is>
+    static bool inDomain(const Row &row, size_t length, index_sequence<Is...>)
+    {
+        return ((Is >= length or static_cast<size_t>(get<Is>(row)) < DOMAIN_SIZE) and ...);
+    }
+
+    // are the first length elements of row inside the domain?
+    static bool inDomain(const Row &row, size_t length)
+    {
+        return inDomain(row, length, index_sequence_for<Ts...>{});
+    }
+
+    template <size_t... Is>
+    static size_t rowOf(const Row &row, size_t length, index_sequence<Is...>)
+    {
+        size_t r = 0;
+        ((Is < length ? r = r * DOMAIN_SIZE + element<Is>(row) : r), ...);
+        return r;
+    }
+
+    // the index of the block of rows of the tuples that start with the first length elements of row
+    static size_t rowOf(const Row &row, size_t length)
+    {
+        return rowOf(row, length, make_index_sequence<arity - 1>{});
+    }
+
+    static size_t encode(const Row &row)
+    {
+        return rowOf(row, arity - 1) * rowBits + element<arity - 1>(row);
+    }
+
+    template <size_t... Is>
+    static Row decode(size_t r, size_t last, index_sequence<Is...>)
+    {
+        // the elements of a row index, from the last to the first
+        size_t values[arity];
+        values[arity - 1] = last;
+        for (size_t i = arity - 1; i > 0; i--) {
+            values[i - 1] = r % DOMAIN_SIZE;
+            r /= DOMAIN_SIZE;
+        }
+        return Row{static_cast<typename tuple_element<Is, Row>::type>(values[Is])...};
+    }
+
+    Row decode(size_t bit) const
+    {
+        return decode(bit / rowBits, bit % rowBits, index_sequence_for<Ts...>{});
+    }
+
+    vector<uint64_t> words;
+    size_t count = 0;
+};
+
+} // namespace datalog
+
+#endif // BIT_MATRIX_SET_H
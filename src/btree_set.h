@@ -0,0 +1,852 @@
+#ifndef BTREE_SET_H
+#define BTREE_SET_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <initializer_list>
+#include <optional>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "thread_pool.h"
+
+namespace datalog
+{
+using namespace std;
+
+// The leading value of a value of a B+ tree: the value itself if it is a number, or its first
+// element if it is a tuple that starts with a number. Nodes keep the leading values of their values
+// in an array of their own, which is searched with vector compares.
+template <typename T>
+struct BTreeLeading
+{
+    static constexpr bool searched = is_arithmetic<T>::value;
+    typedef T Type;
+
+    static const T &of(const T &value)
+    {
+        return value;
+    }
+};
+
+template <typename T, typename... Ts>
+struct BTreeLeading<tuple<T, Ts...>>
+{
+    static constexpr bool searched = is_arithmetic<T>::value;
+    typedef T Type;
+
+    static const T &of(const tuple<T, Ts...> &value)
+    {
+        return get<0>(value);
+    }
+};
+
+// Can values be read while they are being written, as concurrent inserts do? Numbers and tuples
+// of numbers can.
+template <typename T>
+struct IsPlainValue : is_trivially_copyable<T> {};
+
+template <typename... Ts>
+struct IsPlainValue<tuple<Ts...>> : conjunction<IsPlainValue<Ts>...> {};
+
+/**
+ * @brief An ordered set stored in a B+ tree with wide nodes. Values are kept in contiguous arrays
+ * in the nodes, and the leaves are linked, so scans touch few cache lines.
+ *
+ * Inserts may run concurrently with each other, using optimistic lock coupling: each node has a
+ * version, traversals read nodes without locking and restart if a version changed, and only the
+ * nodes that are modified are locked. Nothing else may run concurrently with inserts, and values
+ * must be safe to read while they are being written (as tuples of numbers are), because traversals
+ * compare values before validating them.
+ *
+ * When values are numbers, or tuples that start with numbers, the values of a node are searched
+ * by counting the leading values less than the key with vector compares, and only the values that
+ * share the leading value of the key are compared in full. Keys other than values may take part by
+ * giving their leading value, if they have one, through a member leading() that returns a pointer
+ * to it or nullptr.
+ *
+ * The nodes of a set are allocated from an arena of its own, which takes memory from an upstream
+ * memory resource in growing blocks. Nodes are never freed one by one: clearing, rebuilding or
+ * destroying the set returns the blocks to the upstream resource in bulk, without visiting the
+ * nodes unless the values need destructors.
+ *
+ * @tparam T is the type of the values, which must be default constructible
+ * @tparam COMPARE orders the values, and may be transparent
+ * @tparam NODE_BYTES is the approximate size of the values of a node
+ */
+template <typename T, typename COMPARE = less<T>, size_t NODE_BYTES = 512>
+class BTreeSet
+{
+    static constexpr size_t capacity = NODE_BYTES / sizeof(T) > 4 ? NODE_BYTES / sizeof(T) : 4;
+    // bulk loads leave room in each node, so that later inserts do not split at once
+    static constexpr size_t fill = capacity - capacity / 4;
+    // the bit of a version that is set while the node is locked
+    static constexpr uint64_t locked = 2;
+    // merges and differences of fewer values than this are not split between threads
+    static constexpr size_t parallelSize = 1 << 15;
+
+    typedef BTreeLeading<T> Leading;
+    typedef typename Leading::Type LeadingType;
+    // numbers are their own leading values, tuples keep theirs in a separate array
+    static constexpr bool leadingArray = Leading::searched and not is_arithmetic<T>::value;
+
+    struct NoLeadingValues {};
+
+    struct LeadingValues
+    {
+        LeadingType leading[capacity];
+    };
+
+    struct Node : conditional<leadingArray, LeadingValues, NoLeadingValues>::type
+    {
+        explicit Node(bool leaf) : leaf(leaf) {}
+        atomic<uint64_t> version{0};
+        atomic<size_t> count{0};
+        const bool leaf;
+        T keys[capacity];
+    };
+
+    struct Leaf : Node
+    {
+        Leaf() : Node(true) {}
+        Leaf *next = nullptr;
+    };
+
+    // keys[i] is the least value of children[i + 1]
+    struct Inner : Node
+    {
+        Inner() : Node(false) {}
+        atomic<Node *> children[capacity + 1];
+    };
+
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef COMPARE key_compare;
+    typedef size_t size_type;
+
+    // inserts may run concurrently with each other
+    static constexpr bool concurrentInserts = IsPlainValue<T>::value;
+
+    class const_iterator
+    {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() = default;
+        const_iterator(const Leaf *leaf, size_t index) : leaf(leaf), index(index) {}
+
+        const T &operator*() const
+        {
+            return leaf->keys[index];
+        }
+
+        const T *operator->() const
+        {
+            return &leaf->keys[index];
+        }
+
+        const_iterator &operator++()
+        {
+            if (++index == leaf->count.load(memory_order_relaxed)) {
+                leaf = leaf->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return leaf == other.leaf and index == other.index;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return not (*this == other);
+        }
+
+    private:
+        const Leaf *leaf = nullptr;
+        size_t index = 0;
+    };
+    typedef const_iterator iterator;
+
+    BTreeSet()
+    {
+        reset();
+    }
+
+    /**
+     * @brief an empty set whose arena takes its blocks from a memory resource
+     */
+    explicit BTreeSet(pmr::memory_resource *upstream) : upstream(upstream)
+    {
+        reset();
+    }
+
+    BTreeSet(initializer_list<T> values)
+    {
+        reset();
+        for (const auto &value : values) {
+            insert(value);
+        }
+    }
+
+    // like the copies of pmr containers, a copy takes its blocks from the default resource
+    BTreeSet(const BTreeSet &other)
+    {
+        vector<T> values(other.begin(), other.end());
+        build(values);
+    }
+
+    BTreeSet(BTreeSet &&other)
+    {
+        reset();
+        swap(other);
+    }
+
+    BTreeSet &operator=(const BTreeSet &other)
+    {
+        if (this != &other) {
+            vector<T> values(other.begin(), other.end());
+            release();
+            build(values);
+        }
+        return *this;
+    }
+
+    BTreeSet &operator=(BTreeSet &&other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~BTreeSet()
+    {
+        release();
+    }
+
+    void swap(BTreeSet &other)
+    {
+        Node *r = root.load(memory_order_relaxed);
+        root.store(other.root.load(memory_order_relaxed), memory_order_relaxed);
+        other.root.store(r, memory_order_relaxed);
+        std::swap(head, other.head);
+        size_t n = count.load(memory_order_relaxed);
+        count.store(other.count.load(memory_order_relaxed), memory_order_relaxed);
+        other.count.store(n, memory_order_relaxed);
+        std::swap(upstream, other.upstream);
+        std::swap(arena, other.arena);
+    }
+
+    const_iterator begin() const
+    {
+        return head->count.load(memory_order_relaxed) ? const_iterator{head, 0} : end();
+    }
+
+    const_iterator end() const
+    {
+        return {};
+    }
+
+    size_type size() const
+    {
+        return count.load(memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    void clear()
+    {
+        release();
+        reset();
+    }
+
+    template <typename KEY>
+    const_iterator lower_bound(const KEY &key) const
+    {
+        const Node *node = root.load(memory_order_relaxed);
+        while (not node->leaf) {
+            node = static_cast<const Inner *>(node)->children[lowerBound(node, key)].load(memory_order_relaxed);
+        }
+        return position(static_cast<const Leaf *>(node), lowerBound(node, key));
+    }
+
+    template <typename KEY>
+    const_iterator upper_bound(const KEY &key) const
+    {
+        const Node *node = root.load(memory_order_relaxed);
+        while (not node->leaf) {
+            node = static_cast<const Inner *>(node)->children[upperBound(node, key)].load(memory_order_relaxed);
+        }
+        return position(static_cast<const Leaf *>(node), upperBound(node, key));
+    }
+
+    template <typename KEY>
+    pair<const_iterator, const_iterator> equal_range(const KEY &key) const
+    {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    template <typename KEY>
+    const_iterator find(const KEY &key) const
+    {
+        auto it = lower_bound(key);
+        return it != end() and not compare(key, *it) ? it : end();
+    }
+
+    /**
+     * @brief insert a value, unless an equal value is already in the set. Inserts may run
+     * concurrently with each other, but the iterator returned is only valid once they have finished.
+     *
+     * @return the position of the value in the set, and whether it was inserted
+     */
+    pair<const_iterator, bool> insert(const T &value)
+    {
+        for (;;) {
+            if (auto result = tryInsert(value)) {
+                return *result;
+            }
+        }
+    }
+
+    /**
+     * @brief move the values of another set that are not in this set into this set. A small set is
+     * inserted value by value, otherwise both sets are merged in one pass and the tree is rebuilt.
+     * Unlike std::set::merge the other set is left empty.
+     *
+     * @param other
+     */
+    void merge(BTreeSet &other)
+    {
+        if (other.empty()) {
+            return;
+        }
+        if (empty()) {
+            swap(other);
+        } else if (other.size() * 8 < size()) {
+            for (const auto &value : other) {
+                insert(value);
+            }
+        } else {
+            vector<T> merged;
+            merged.reserve(size() + other.size());
+            set_union(begin(), end(), other.begin(), other.end(), back_inserter(merged), compare);
+            release();
+            build(merged);
+        }
+        other.clear();
+    }
+
+    /**
+     * @brief remove the values of this set that are in another set: in one pass, or by lookups when
+     * this set is much smaller
+     *
+     * @param other
+     */
+    void subtract(const BTreeSet &other)
+    {
+        if (empty() or other.empty()) {
+            return;
+        }
+        vector<T> difference;
+        difference.reserve(size());
+        if (size() * 8 < other.size()) {
+            // look up the values of a small set, rather than scanning the other set
+            copy_if(begin(), end(), back_inserter(difference), [&other](const T &value) {
+                return other.find(value) == other.end();
+            });
+        } else {
+            set_difference(begin(), end(), other.begin(), other.end(), back_inserter(difference), compare);
+        }
+        if (difference.size() != size()) {
+            release();
+            build(difference);
+        }
+    }
+
+    /**
+     * @brief as merge, but large sets are split by value into ranges, which are merged in one pass
+     * each by the tasks of a pool
+     *
+     * @param other
+     * @param pool
+     */
+    void merge(BTreeSet &other, ThreadPool &pool)
+    {
+        if (empty() or other.size() * 8 < size() or size() + other.size() < parallelSize or pool.concurrency() == 1) {
+            merge(other);
+            return;
+        }
+        vector<T> merged = overRanges(pool, [&other](const BTreeSet &set, const T *from, const T *to, vector<T> &values) {
+            const auto range = set.range(from, to);
+            const auto otherRange = other.range(from, to);
+            set_union(range.first, range.second, otherRange.first, otherRange.second, back_inserter(values), set.compare);
+        });
+        release();
+        build(merged);
+        other.clear();
+    }
+
+    /**
+     * @brief as subtract, but large sets are split by value into ranges, whose differences are
+     * taken by the tasks of a pool
+     *
+     * @param other
+     * @param pool
+     */
+    void subtract(const BTreeSet &other, ThreadPool &pool)
+    {
+        if (empty() or other.empty() or size() * 8 < other.size() or size() < parallelSize or pool.concurrency() == 1) {
+            subtract(other);
+            return;
+        }
+        vector<T> difference = overRanges(pool, [&other](const BTreeSet &set, const T *from, const T *to, vector<T> &values) {
+            const auto range = set.range(from, to);
+            const auto otherRange = other.range(from, to);
+            set_difference(range.first, range.second, otherRange.first, otherRange.second, back_inserter(values), set.compare);
+        });
+        if (difference.size() != size()) {
+            release();
+            build(difference);
+        }
+    }
+
+    bool operator==(const BTreeSet &other) const
+    {
+        return size() == other.size() and equal(begin(), end(), other.begin(), [this](const T &a, const T &b) {
+            return not compare(a, b) and not compare(b, a);
+        });
+    }
+
+    bool operator!=(const BTreeSet &other) const
+    {
+        return not (*this == other);
+    }
+
+private:
+    // the number of values of a node that are less than key
+    template <typename KEY>
+    size_t lowerBound(const Node *node, const KEY &key) const
+    {
+        return search(node, key, [this, &key](const T &value) { return compare(value, key); });
+    }
+
+    // the number of values of a node that are not greater than key
+    template <typename KEY>
+    size_t upperBound(const Node *node, const KEY &key) const
+    {
+        return search(node, key, [this, &key](const T &value) { return not compare(key, value); });
+    }
+
+    // the leading value of a key, or nullptr if it has none
+    template <typename KEY>
+    static const LeadingType *leadingValue(const KEY &key)
+    {
+        if constexpr (is_same<KEY, T>::value) {
+            return &Leading::of(key);
+        } else if constexpr (hasLeading<KEY>(0)) {
+            const auto *value = key.leading();
+            return value ? &Leading::of(*value) : nullptr;
+        } else {
+            return nullptr;
+        }
+    }
+
+    template <typename KEY>
+    static constexpr auto hasLeading(int) -> decltype(declval<const KEY &>().leading(), true)
+    {
+        return true;
+    }
+
+    template <typename KEY>
+    static constexpr bool hasLeading(...)
+    {
+        return false;
+    }
+
+    static const LeadingType *leadingValues(const Node *node)
+    {
+        if constexpr (leadingArray) {
+            return node->leading;
+        } else {
+            return node->keys;
+        }
+    }
+
+    // the length of the prefix of the values of a node that satisfies before, which must be a
+    // prefix. The values are narrowed to those that share the leading value of the key by counting
+    // (in a loop that compiles to vector compares), then searched by a branch-free binary search.
+    template <typename KEY, typename BEFORE>
+    size_t search(const Node *node, const KEY &key, BEFORE before) const
+    {
+        size_t first = 0;
+        size_t n = node->count.load(memory_order_relaxed);
+        if constexpr (Leading::searched and (is_same<COMPARE, less<T>>::value or is_same<COMPARE, less<>>::value)) {
+            if (const LeadingType *value = leadingValue(key)) {
+                const LeadingType *leading = leadingValues(node);
+                size_t smaller = 0;
+                size_t notGreater = 0;
+                for (size_t i = 0; i < n; i++) {
+                    smaller += leading[i] < *value;
+                    notGreater += not (*value < leading[i]);
+                }
+                first = smaller;
+                n = notGreater - smaller;
+            }
+        }
+        return first + search(node->keys + first, n, before);
+    }
+
+    // the length of the prefix of keys[0, n) that satisfies before, which must be a prefix
+    template <typename BEFORE>
+    static size_t search(const T *keys, size_t n, BEFORE before)
+    {
+        if (n == 0) {
+            return 0;
+        }
+        const T *base = keys;
+        while (n > 1) {
+            const size_t half = n / 2;
+            base = before(base[half]) ? base + half : base;
+            n -= half;
+        }
+        return base - keys + before(*base);
+    }
+
+    // copy the leading values of the values of a node from an index on
+    static void refresh(Node *node, size_t from)
+    {
+        if constexpr (leadingArray) {
+            const size_t n = node->count.load(memory_order_relaxed);
+            for (size_t i = from; i < n; i++) {
+                node->leading[i] = Leading::of(node->keys[i]);
+            }
+        }
+    }
+
+    // the iterator at an index of a leaf, which may be one past its last value
+    const_iterator position(const Leaf *leaf, size_t index) const
+    {
+        if (index == leaf->count.load(memory_order_relaxed)) {
+            return leaf->next ? const_iterator{leaf->next, 0} : end();
+        }
+        return {leaf, index};
+    }
+
+    static bool readLock(const Node *node, uint64_t &version)
+    {
+        version = node->version.load(memory_order_acquire);
+        return not (version & locked);
+    }
+
+    // has the node changed since it was read at a version?
+    static bool validate(const Node *node, uint64_t version)
+    {
+        atomic_thread_fence(memory_order_acquire);
+        return node->version.load(memory_order_relaxed) == version;
+    }
+
+    static bool writeLock(Node *node, uint64_t version)
+    {
+        return node->version.compare_exchange_strong(version, version + locked, memory_order_acquire);
+    }
+
+    static void unlock(Node *node)
+    {
+        node->version.fetch_add(locked, memory_order_release);
+    }
+
+    // one attempt at an insert, which gives up (returning nothing) when it sees a concurrent change
+    optional<pair<const_iterator, bool>> tryInsert(const T &value)
+    {
+        Node *node = root.load(memory_order_acquire);
+        uint64_t version;
+        if (not readLock(node, version) or node != root.load(memory_order_acquire)) {
+            return {};
+        }
+        Inner *parent = nullptr;
+        uint64_t parentVersion = 0;
+        for (;;) {
+            // split full nodes on the way down, so that a parent always has room for a new child
+            if (node->count.load(memory_order_relaxed) == capacity) {
+                split(parent, parentVersion, node, version);
+                return {};
+            }
+            if (node->leaf) {
+                break;
+            }
+            Inner *inner = static_cast<Inner *>(node);
+            if (parent and not validate(parent, parentVersion)) {
+                return {};
+            }
+            Node *child = inner->children[upperBound(inner, value)].load(memory_order_relaxed);
+            if (not validate(inner, version)) {
+                return {};
+            }
+            parent = inner;
+            parentVersion = version;
+            node = child;
+            if (not readLock(node, version)) {
+                return {};
+            }
+        }
+        Leaf *leaf = static_cast<Leaf *>(node);
+        if (not writeLock(leaf, version)) {
+            return {};
+        }
+        if (parent and not validate(parent, parentVersion)) {
+            unlock(leaf);
+            return {};
+        }
+        const size_t n = leaf->count.load(memory_order_relaxed);
+        const size_t i = lowerBound(leaf, value);
+        if (i < n and not compare(value, leaf->keys[i])) {
+            unlock(leaf);
+            return {{const_iterator{leaf, i}, false}};
+        }
+        move_backward(leaf->keys + i, leaf->keys + n, leaf->keys + n + 1);
+        leaf->keys[i] = value;
+        leaf->count.store(n + 1, memory_order_relaxed);
+        refresh(leaf, i);
+        count.fetch_add(1, memory_order_relaxed);
+        unlock(leaf);
+        return {{const_iterator{leaf, i}, true}};
+    }
+
+    // split a full node, if neither it nor its parent changed since they were read
+    void split(Inner *parent, uint64_t parentVersion, Node *node, uint64_t version)
+    {
+        if (parent and not writeLock(parent, parentVersion)) {
+            return;
+        }
+        if (not writeLock(node, version)) {
+            if (parent) {
+                unlock(parent);
+            }
+            return;
+        }
+        if (not parent and node != root.load(memory_order_acquire)) {
+            // another insert grew the tree above this node
+            unlock(node);
+            return;
+        }
+        T separator;
+        Node *sibling = node->leaf ? splitLeaf(static_cast<Leaf *>(node), separator) : splitInner(static_cast<Inner *>(node), separator);
+        if (parent) {
+            const size_t n = parent->count.load(memory_order_relaxed);
+            const size_t i = upperBound(parent, separator);
+            move_backward(parent->keys + i, parent->keys + n, parent->keys + n + 1);
+            for (size_t j = n + 1; j > i + 1; j--) {
+                parent->children[j].store(parent->children[j - 1].load(memory_order_relaxed), memory_order_relaxed);
+            }
+            parent->keys[i] = separator;
+            parent->children[i + 1].store(sibling, memory_order_relaxed);
+            parent->count.store(n + 1, memory_order_relaxed);
+            refresh(parent, i);
+        } else {
+            Inner *newRoot = allocate<Inner>();
+            newRoot->keys[0] = separator;
+            newRoot->children[0].store(node, memory_order_relaxed);
+            newRoot->children[1].store(sibling, memory_order_relaxed);
+            newRoot->count.store(1, memory_order_relaxed);
+            refresh(newRoot, 0);
+            root.store(newRoot, memory_order_release);
+        }
+        unlock(node);
+        if (parent) {
+            unlock(parent);
+        }
+    }
+
+    // move the upper half of a leaf to a new leaf after it
+    Node *splitLeaf(Leaf *leaf, T &separator)
+    {
+        Leaf *sibling = allocate<Leaf>();
+        const size_t half = capacity / 2;
+        move(leaf->keys + half, leaf->keys + capacity, sibling->keys);
+        sibling->count.store(capacity - half, memory_order_relaxed);
+        refresh(sibling, 0);
+        sibling->next = leaf->next;
+        leaf->count.store(half, memory_order_relaxed);
+        leaf->next = sibling;
+        separator = sibling->keys[0];
+        return sibling;
+    }
+
+    // move the keys and children after the middle key of an inner node to a new node, and the
+    // middle key to the parent
+    Node *splitInner(Inner *inner, T &separator)
+    {
+        Inner *sibling = allocate<Inner>();
+        const size_t middle = capacity / 2;
+        separator = inner->keys[middle];
+        move(inner->keys + middle + 1, inner->keys + capacity, sibling->keys);
+        for (size_t i = middle + 1; i <= capacity; i++) {
+            sibling->children[i - middle - 1].store(inner->children[i].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        sibling->count.store(capacity - middle - 1, memory_order_relaxed);
+        refresh(sibling, 0);
+        inner->count.store(middle, memory_order_relaxed);
+        return sibling;
+    }
+
+    // the values in [from, to), where a null bound is unbounded
+    pair<const_iterator, const_iterator> range(const T *from, const T *to) const
+    {
+        return {from ? lower_bound(*from) : begin(), to ? lower_bound(*to) : end()};
+    }
+
+    // Split the values into about a range per task of a pool, at the least values of leaves, and
+    // concatenate the values that a function of the set and each range [from, to) adds to a vector
+    template <typename F>
+    vector<T> overRanges(ThreadPool &pool, F f) const
+    {
+        const size_t parts = pool.concurrency() * 2;
+        vector<T> bounds;
+        size_t values = 0;
+        for (const Leaf *leaf = head; leaf; leaf = leaf->next) {
+            if (values >= size() * (bounds.size() + 1) / parts) {
+                bounds.push_back(leaf->keys[0]);
+            }
+            values += leaf->count.load(memory_order_relaxed);
+        }
+        // the first bound is the least value
+        vector<vector<T>> ranges(bounds.size());
+        vector<function<void()>> tasks;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            tasks.push_back([this, &f, &bounds, &ranges, i]() {
+                f(*this, i ? &bounds[i] : nullptr, i + 1 < bounds.size() ? &bounds[i + 1] : nullptr, ranges[i]);
+            });
+        }
+        pool.run(tasks);
+        size_t total = 0;
+        for (const auto &range : ranges) {
+            total += range.size();
+        }
+        vector<T> joined;
+        joined.reserve(total);
+        for (auto &range : ranges) {
+            joined.insert(joined.end(), make_move_iterator(range.begin()), make_move_iterator(range.end()));
+        }
+        return joined;
+    }
+
+    // build the tree bottom up from sorted distinct values
+    void build(vector<T> &values)
+    {
+        if (values.empty()) {
+            reset();
+            return;
+        }
+        // each node of a level, with a pointer to its least value
+        vector<pair<Node *, const T *>> level;
+        Leaf *previous = nullptr;
+        for (size_t i = 0; i < values.size(); i += fill) {
+            Leaf *leaf = allocate<Leaf>();
+            const size_t n = min(fill, values.size() - i);
+            move(values.begin() + i, values.begin() + i + n, leaf->keys);
+            leaf->count.store(n, memory_order_relaxed);
+            refresh(leaf, 0);
+            if (previous) {
+                previous->next = leaf;
+            } else {
+                head = leaf;
+            }
+            previous = leaf;
+            level.push_back({leaf, &leaf->keys[0]});
+        }
+        while (level.size() > 1) {
+            vector<pair<Node *, const T *>> parents;
+            for (size_t i = 0; i < level.size(); i += fill + 1) {
+                Inner *inner = allocate<Inner>();
+                const size_t n = min(fill + 1, level.size() - i);
+                inner->children[0].store(level[i].first, memory_order_relaxed);
+                for (size_t j = 1; j < n; j++) {
+                    inner->keys[j - 1] = *level[i + j].second;
+                    inner->children[j].store(level[i + j].first, memory_order_relaxed);
+                }
+                inner->count.store(n - 1, memory_order_relaxed);
+                refresh(inner, 0);
+                parents.push_back({inner, level[i].second});
+            }
+            std::swap(level, parents);
+        }
+        root.store(level.front().first, memory_order_relaxed);
+        count.store(values.size(), memory_order_relaxed);
+    }
+
+    // an empty tree is a single empty leaf
+    void reset()
+    {
+        head = allocate<Leaf>();
+        root.store(head, memory_order_relaxed);
+        count.store(0, memory_order_relaxed);
+    }
+
+    // a node from the arena (splits may allocate concurrently)
+    template <typename NODE>
+    NODE *allocate()
+    {
+        lock_guard<mutex> lock(arenaMutex);
+        return new (arena->allocate(sizeof(NODE), alignof(NODE))) NODE;
+    }
+
+    // destroy every node, and return the arena's blocks to the upstream resource
+    void release()
+    {
+        if constexpr (not is_trivially_destructible<T>::value) {
+            destroy(root.load(memory_order_relaxed));
+        }
+        arena->release();
+    }
+
+    static void destroy(Node *node)
+    {
+        if (not node->leaf) {
+            Inner *inner = static_cast<Inner *>(node);
+            for (size_t i = 0; i <= inner->count.load(memory_order_relaxed); i++) {
+                destroy(inner->children[i].load(memory_order_relaxed));
+            }
+            inner->~Inner();
+        } else {
+            static_cast<Leaf *>(node)->~Leaf();
+        }
+    }
+
+    pmr::memory_resource *upstream = pmr::get_default_resource();
+    unique_ptr<pmr::monotonic_buffer_resource> arena = make_unique<pmr::monotonic_buffer_resource>(4 * sizeof(Inner), upstream);
+    mutex arenaMutex;
+    atomic<Node *> root{nullptr};
+    // the leftmost leaf, which splits never replace
+    Leaf *head = nullptr;
+    atomic<size_t> count{0};
+    COMPARE compare;
+};
+
+} // namespace datalog
+
+#endif // BTREE_SET_H
@@ -0,0 +1,419 @@
+#ifndef COLUMNAR_SET_H
+#define COLUMNAR_SET_H
+
+#include <vector>
+#include <tuple>
+#include <numeric>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cassert>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief A set of tuples stored column by column: one contiguous array per element of the tuple.
+ * Tuples are kept in lexicographic order.
+ *
+ * Like FlatSet, inserts are batched: insert appends rows to an unsorted tail, and flush sorts the
+ * tail and merges it into the sorted rows. The set must be flushed before it is read.
+ *
+ * Iterators dereference to copies of the rows, so filters on individual columns should scan the
+ * arrays returned by column instead.
+ *
+ * @tparam Ts are the types of the elements of the tuples
+ */
+template <typename... Ts>
+class ColumnarSet
+{
+public:
+    typedef tuple<Ts...> Row;
+    typedef Row value_type;
+    typedef value_type key_type;
+    typedef size_t size_type;
+    typedef tuple<vector<Ts>...> ColumnsType;
+
+    class const_iterator
+    {
+    public:
+        typedef random_access_iterator_tag iterator_category;
+        typedef typename ColumnarSet::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef value_type reference;
+
+        // holds a copy of a row, so that it-> works
+        struct ArrowProxy
+        {
+            value_type value;
+            const value_type *operator->() const
+            {
+                return &value;
+            }
+        };
+
+        const_iterator() = default;
+        const_iterator(const ColumnarSet *set, size_t row) : set(set), row(row) {}
+
+        value_type operator*() const
+        {
+            return set->at(row);
+        }
+
+        ArrowProxy operator->() const
+        {
+            return {set->at(row)};
+        }
+
+        value_type operator[](difference_type n) const
+        {
+            return set->at(row + n);
+        }
+
+        size_t position() const
+        {
+            return row;
+        }
+
+        const_iterator &operator++() { ++row; return *this; }
+        const_iterator operator++(int) { auto it = *this; ++row; return it; }
+        const_iterator &operator--() { --row; return *this; }
+        const_iterator operator--(int) { auto it = *this; --row; return it; }
+        const_iterator &operator+=(difference_type n) { row += n; return *this; }
+        const_iterator &operator-=(difference_type n) { row -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return {set, row + n}; }
+        const_iterator operator-(difference_type n) const { return {set, row - n}; }
+        difference_type operator-(const const_iterator &other) const { return difference_type(row) - difference_type(other.row); }
+        bool operator==(const const_iterator &other) const { return row == other.row and set == other.set; }
+        bool operator!=(const const_iterator &other) const { return not (*this == other); }
+        bool operator<(const const_iterator &other) const { return row < other.row; }
+        bool operator>(const const_iterator &other) const { return row > other.row; }
+        bool operator<=(const const_iterator &other) const { return row <= other.row; }
+        bool operator>=(const const_iterator &other) const { return row >= other.row; }
+
+    private:
+        const ColumnarSet *set = nullptr;
+        size_t row = 0;
+    };
+    typedef const_iterator iterator;
+
+    ColumnarSet() = default;
+
+    ColumnarSet(initializer_list<value_type> values)
+    {
+        for (const auto &value : values) {
+            insert(value);
+        }
+        flush();
+    }
+
+    const_iterator begin() const
+    {
+        assert(flushed());
+        return {this, 0};
+    }
+
+    const_iterator end() const
+    {
+        assert(flushed());
+        return {this, rows()};
+    }
+
+    size_type size() const
+    {
+        assert(flushed());
+        return rows();
+    }
+
+    bool empty() const
+    {
+        return rows() == 0;
+    }
+
+    void clear()
+    {
+        apply([](auto &... column) { ((column.clear()), ...); }, columns);
+        sorted = 0;
+    }
+
+    value_type at(size_t row) const
+    {
+        return getRow(row, index_sequence_for<Ts...>{});
+    }
+
+    /**
+     * @brief the array of the elements at position C of the tuples, in row order
+     */
+    template <size_t C>
+    const vector<typename tuple_element<C, Row>::type> &column() const
+    {
+        return get<C>(columns);
+    }
+
+    /**
+     * @brief add a row to the unsorted tail of the set (the set must be flushed before it is read)
+     *
+     * @param value
+     */
+    void insert(const value_type &value)
+    {
+        appendRow(value, index_sequence_for<Ts...>{});
+    }
+
+    /**
+     * @brief sort the rows inserted since the last flush and merge them into the set
+     */
+    void flush()
+    {
+        if (flushed()) {
+            return;
+        }
+        vector<size_t> order(rows());
+        iota(order.begin(), order.end(), 0);
+        const auto middle = order.begin() + sorted;
+        auto less = [this](size_t a, size_t b) { return compareRows(*this, a, *this, b) < 0; };
+        sort(middle, order.end(), less);
+        inplace_merge(order.begin(), middle, order.end(), less);
+        order.erase(unique(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return compareRows(*this, a, *this, b) == 0;
+        }), order.end());
+        ColumnarSet result;
+        result.reserve(order.size());
+        for (size_t row : order) {
+            result.appendRow(*this, row);
+        }
+        swap(columns, result.columns);
+        sorted = rows();
+    }
+
+    bool flushed() const
+    {
+        return sorted == rows();
+    }
+
+    /**
+     * @brief the rows whose first length elements equal those of key, found by binary searches of
+     * the columns
+     *
+     * @return the range [first, last) of rows
+     */
+    pair<size_t, size_t> prefixRange(const Row &key, size_t length) const
+    {
+        assert(flushed());
+        pair<size_t, size_t> range{0, rows()};
+        narrow(range, key, length, index_sequence_for<Ts...>{});
+        return range;
+    }
+
+    /**
+     * @brief the row equal to a value, or end if there is none
+     */
+    const_iterator find(const value_type &value) const
+    {
+        const auto range = prefixRange(value, sizeof...(Ts));
+        return range.first == range.second ? end() : const_iterator{this, range.first};
+    }
+
+    /**
+     * @brief visit the rows in [first, last) whose elements at the given positions equal those of
+     * key. Each position is checked by a branch-free scan of its column.
+     */
+    template <typename F>
+    void forEachMatch(size_t first, size_t last, const Row &key, size_t positions, F f) const
+    {
+        vector<unsigned char> matches(last - first, 1);
+        filter(matches, first, key, positions, index_sequence_for<Ts...>{});
+        for (size_t i = 0; i < matches.size(); i++) {
+            if (matches[i]) {
+                f(const_iterator{this, first + i});
+            }
+        }
+    }
+
+    /**
+     * @brief move the rows of another set that are not in this set into this set, in one pass.
+     * Unlike std::set::merge the other set is left empty.
+     *
+     * @param other
+     */
+    void merge(ColumnarSet &other)
+    {
+        flush();
+        other.flush();
+        if (other.empty()) {
+            return;
+        }
+        if (empty()) {
+            swap(columns, other.columns);
+            sorted = rows();
+            other.clear();
+            return;
+        }
+        ColumnarSet result;
+        result.reserve(rows() + other.rows());
+        size_t a = 0;
+        size_t b = 0;
+        while (a < rows() and b < other.rows()) {
+            const int c = compareRows(*this, a, other, b);
+            if (c > 0) {
+                result.appendRow(other, b++);
+            } else {
+                if (c == 0) {
+                    b++;
+                }
+                result.appendRow(*this, a++);
+            }
+        }
+        for (; a < rows(); a++) {
+            result.appendRow(*this, a);
+        }
+        for (; b < other.rows(); b++) {
+            result.appendRow(other, b);
+        }
+        swap(columns, result.columns);
+        sorted = rows();
+        other.clear();
+    }
+
+    /**
+     * @brief remove the rows of this set that are in another set, in one pass
+     *
+     * @param other
+     */
+    void subtract(const ColumnarSet &other)
+    {
+        flush();
+        ColumnarSet result;
+        size_t b = 0;
+        for (size_t a = 0; a < rows(); a++) {
+            while (b < other.rows() and compareRows(other, b, *this, a) < 0) {
+                b++;
+            }
+            if (b == other.rows() or compareRows(*this, a, other, b) < 0) {
+                result.appendRow(*this, a);
+            }
+        }
+        swap(columns, result.columns);
+        sorted = rows();
+    }
+
+    bool operator==(const ColumnarSet &other) const
+    {
+        if (size() != other.size()) {
+            return false;
+        }
+        for (size_t row = 0; row < rows(); row++) {
+            if (compareRows(*this, row, other, row)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const ColumnarSet &other) const
+    {
+        return not (*this == other);
+    }
+
+private:
+    size_t rows() const
+    {
+        return get<0>(columns).size();
+    }
+
+    template <typename T>
+    static int compare(const T &a, const T &b)
+    {
+        return a < b ? -1 : (b < a ? 1 : 0);
+    }
+
+    template <size_t... Is>
+    static int compareRows(const ColumnarSet &a, size_t i, const ColumnarSet &b, size_t j, index_sequence<Is...>)
+    {
+        int c = 0;
+        ((c == 0 ? (c = compare(get<Is>(a.columns)[i], get<Is>(b.columns)[j])) : c), ...);
+        return c;
+    }
+
+    static int compareRows(const ColumnarSet &a, size_t i, const ColumnarSet &b, size_t j)
+    {
+        return compareRows(a, i, b, j, index_sequence_for<Ts...>{});
+    }
+
+    template <size_t... Is>
+    Row getRow(size_t row, index_sequence<Is...>) const
+    {
+        return Row{get<Is>(columns)[row]...};
+    }
+
+    template <size_t... Is>
+    void appendRow(const value_type &value, index_sequence<Is...>)
+    {
+        ((get<Is>(columns).push_back(get<Is>(value))), ...);
+    }
+
+    template <size_t... Is>
+    void appendRow(const ColumnarSet &set, size_t row, index_sequence<Is...>)
+    {
+        ((get<Is>(columns).push_back(get<Is>(set.columns)[row])), ...);
+    }
+
+    void appendRow(const ColumnarSet &set, size_t row)
+    {
+        appendRow(set, row, index_sequence_for<Ts...>{});
+    }
+
+    void reserve(size_t n)
+    {
+        apply([n](auto &... column) { ((column.reserve(n)), ...); }, columns);
+    }
+
+    // within a range of rows that agree on the earlier columns, each column is sorted
+    template <size_t C>
+    void narrow(pair<size_t, size_t> &range, const Row &key, size_t length) const
+    {
+        if (C < length) {
+            const auto &column = get<C>(columns);
+            const auto &value = get<C>(key);
+            const auto first = column.begin() + range.first;
+            const auto last = column.begin() + range.second;
+            const auto bounds = std::equal_range(first, last, value);
+            range = {bounds.first - column.begin(), bounds.second - column.begin()};
+        }
+    }
+
+    template <size_t... Is>
+    void narrow(pair<size_t, size_t> &range, const Row &key, size_t length, index_sequence<Is...>) const
+    {
+        ((narrow<Is>(range, key, length)), ...);
+    }
+
+    template <size_t C>
+    void filter(vector<unsigned char> &matches, size_t first, const Row &key, size_t positions) const
+    {
+        if (positions & (size_t{1} << C)) {
+            const auto &column = get<C>(columns);
+            const auto value = get<C>(key);
+            const size_t n = matches.size();
+            for (size_t i = 0; i < n; i++) {
+                matches[i] &= column[first + i] == value;
+            }
+        }
+    }
+
+    template <size_t... Is>
+    void filter(vector<unsigned char> &matches, size_t first, const Row &key, size_t positions, index_sequence<Is...>) const
+    {
+        ((filter<Is>(matches, first, key, positions)), ...);
+    }
+
+    ColumnsType columns;
+    // the rows before this position are sorted and distinct
+    size_type sorted = 0;
+};
+
+} // namespace datalog
+
+#endif // COLUMNAR_SET_H
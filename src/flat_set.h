@@ -0,0 +1,222 @@
+#ifndef FLAT_SET_H
+#define FLAT_SET_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+#include <cassert>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief A set stored as a contiguous sorted vector.
+ *
+ * Inserts are batched: insert appends to an unsorted tail, and flush sorts the tail and merges it
+ * into the sorted values in one pass. The set must be flushed before it is read.
+ *
+ * @tparam T is the type of the values
+ * @tparam COMPARE orders the values, and may be transparent
+ */
+template <typename T, typename COMPARE = less<T>>
+class FlatSet
+{
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef COMPARE key_compare;
+    typedef typename vector<T>::size_type size_type;
+    typedef typename vector<T>::const_iterator const_iterator;
+    typedef const_iterator iterator;
+
+    FlatSet() = default;
+
+    FlatSet(initializer_list<T> values)
+    {
+        insert(values.begin(), values.end());
+        flush();
+    }
+
+    const_iterator begin() const
+    {
+        assert(flushed());
+        return values.begin();
+    }
+
+    const_iterator end() const
+    {
+        assert(flushed());
+        return values.end();
+    }
+
+    size_type size() const
+    {
+        assert(flushed());
+        return values.size();
+    }
+
+    bool empty() const
+    {
+        return values.empty();
+    }
+
+    void clear()
+    {
+        values.clear();
+        sorted = 0;
+    }
+
+    void reserve(size_type n)
+    {
+        values.reserve(n);
+    }
+
+    /**
+     * @brief add a value to the unsorted tail of the set (the set must be flushed before it is read)
+     *
+     * @param value
+     */
+    void insert(const T &value)
+    {
+        values.push_back(value);
+    }
+
+    template <typename ITERATOR>
+    void insert(ITERATOR first, ITERATOR last)
+    {
+        values.insert(values.end(), first, last);
+    }
+
+    /**
+     * @brief sort the values inserted since the last flush, and merge them into the set. Of equal
+     * values, the one inserted first is kept.
+     */
+    void flush()
+    {
+        if (flushed()) {
+            return;
+        }
+        const auto middle = values.begin() + sorted;
+        stable_sort(middle, values.end(), compare);
+        inplace_merge(values.begin(), middle, values.end(), compare);
+        values.erase(unique(values.begin(), values.end(), [this](const T &a, const T &b) {
+            return not compare(a, b) and not compare(b, a);
+        }), values.end());
+        sorted = values.size();
+    }
+
+    bool flushed() const
+    {
+        return sorted == values.size();
+    }
+
+    template <typename KEY>
+    const_iterator lower_bound(const KEY &key) const
+    {
+        return std::lower_bound(begin(), end(), key, compare);
+    }
+
+    template <typename KEY>
+    const_iterator upper_bound(const KEY &key) const
+    {
+        return std::upper_bound(begin(), end(), key, compare);
+    }
+
+    template <typename KEY>
+    pair<const_iterator, const_iterator> equal_range(const KEY &key) const
+    {
+        return std::equal_range(begin(), end(), key, compare);
+    }
+
+    template <typename KEY>
+    const_iterator find(const KEY &key) const
+    {
+        auto it = lower_bound(key);
+        return it != end() and not compare(key, *it) ? it : end();
+    }
+
+    /**
+     * @brief move the values of another set that are not in this set into this set, in one pass.
+     * Unlike std::set::merge the other set is left empty.
+     *
+     * @param other
+     */
+    void merge(FlatSet &other)
+    {
+        flush();
+        other.flush();
+        if (other.values.empty()) {
+            return;
+        }
+        if (values.empty()) {
+            swap(values, other.values);
+        } else {
+            vector<T> merged;
+            merged.reserve(values.size() + other.values.size());
+            auto a = values.begin();
+            auto b = other.values.begin();
+            while (a != values.end() and b != other.values.end()) {
+                if (compare(*b, *a)) {
+                    merged.push_back(move(*b++));
+                } else {
+                    if (not compare(*a, *b)) {
+                        ++b;
+                    }
+                    merged.push_back(move(*a++));
+                }
+            }
+            merged.insert(merged.end(), make_move_iterator(a), make_move_iterator(values.end()));
+            merged.insert(merged.end(), make_move_iterator(b), make_move_iterator(other.values.end()));
+            swap(values, merged);
+        }
+        sorted = values.size();
+        other.clear();
+    }
+
+    /**
+     * @brief remove the values of this set that are in another set, in one pass
+     *
+     * @param other
+     */
+    void subtract(const FlatSet &other)
+    {
+        flush();
+        auto b = other.begin();
+        auto out = values.begin();
+        for (auto a = values.begin(); a != values.end(); ++a) {
+            while (b != other.end() and compare(*b, *a)) {
+                ++b;
+            }
+            if (b == other.end() or compare(*a, *b)) {
+                *out++ = move(*a);
+            }
+        }
+        values.erase(out, values.end());
+        sorted = values.size();
+    }
+
+    bool operator==(const FlatSet &other) const
+    {
+        return size() == other.size() and equal(begin(), end(), other.begin(), [this](const T &a, const T &b) {
+            return not compare(a, b) and not compare(b, a);
+        });
+    }
+
+    bool operator!=(const FlatSet &other) const
+    {
+        return not (*this == other);
+    }
+
+private:
+    vector<T> values;
+    // the values before this position are sorted and distinct
+    size_type sorted = 0;
+    COMPARE compare;
+};
+
+} // namespace datalog
+
+#endif // FLAT_SET_H
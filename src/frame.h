@@ -0,0 +1,220 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <new>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief The layout of the slots of a frame: each distinct variable of a rule is given a slot, at an
+ * offset in a contiguous block, when the rule is built. Variables are identified by their address,
+ * and the offsets of their slots are found by a hash of it, so that variables read by external
+ * functions are found in constant time.
+ */
+class FrameLayout
+{
+public:
+    // the slot of an argument that is not a variable
+    static constexpr size_t none = SIZE_MAX;
+
+    /**
+     * @brief the offset of the slot of a variable of type T, which is added to the layout if it is
+     * not there
+     */
+    template <typename T>
+    size_t add(const void *variable)
+    {
+        const size_t existing = offset(variable);
+        if (existing != none) {
+            return existing;
+        }
+        typedef optional<T> SlotType;
+        static_assert(alignof(SlotType) <= alignof(max_align_t), "variable type too aligned for a frame");
+        const size_t slotOffset = (bytes + alignof(SlotType) - 1) / alignof(SlotType) * alignof(SlotType);
+        slots.push_back({variable, slotOffset, &construct<T>, &destroy<T>, &reset<T>});
+        offsets.emplace(variable, slotOffset);
+        bytes = slotOffset + sizeof(SlotType);
+        return slotOffset;
+    }
+
+    /**
+     * @brief the offset of the slot of a variable, or none if the variable is not in the layout
+     */
+    size_t offset(const void *variable) const
+    {
+        const auto it = offsets.find(variable);
+        return it == offsets.end() ? none : it->second;
+    }
+
+    /**
+     * @brief the number of slots
+     */
+    size_t size() const
+    {
+        return slots.size();
+    }
+
+private:
+    friend class Frame;
+
+    struct Slot
+    {
+        const void *variable;
+        size_t offset;
+        void (*construct)(void *);
+        void (*destroy)(void *);
+        void (*reset)(void *);
+    };
+
+    template <typename T>
+    static void construct(void *slot)
+    {
+        new (slot) optional<T>();
+    }
+
+    template <typename T>
+    static void destroy(void *slot)
+    {
+        static_cast<optional<T> *>(slot)->~optional<T>();
+    }
+
+    template <typename T>
+    static void reset(void *slot)
+    {
+        static_cast<optional<T> *>(slot)->reset();
+    }
+
+    vector<Slot> slots;
+    // the offset of the slot of each variable
+    unordered_map<const void *, size_t> offsets;
+    size_t bytes = 0;
+};
+
+/**
+ * @brief The bindings of the variables of a rule during one evaluation of it: a contiguous block of
+ * optional values laid out by a FrameLayout. Each evaluation of a rule has its own frame, so a rule
+ * may be evaluated by several threads at once.
+ *
+ * While a frame is active on a thread (see Activation), Variable::value reads the variables of the
+ * frame, so that external functions see the bindings of the evaluation that calls them.
+ */
+class Frame
+{
+public:
+    explicit Frame(const FrameLayout &layout)
+        : layout(layout), storage((layout.bytes + sizeof(max_align_t) - 1) / sizeof(max_align_t))
+    {
+        for (const auto &slot : layout.slots) {
+            slot.construct(data() + slot.offset);
+        }
+    }
+
+    Frame(const Frame &) = delete;
+    Frame &operator=(const Frame &) = delete;
+
+    ~Frame()
+    {
+        for (const auto &slot : layout.slots) {
+            slot.destroy(data() + slot.offset);
+        }
+    }
+
+    /**
+     * @brief the slot of a variable of type T, at an offset given by the layout
+     */
+    template <typename T>
+    optional<T> &slot(size_t offset)
+    {
+        assert(offset != FrameLayout::none);
+        return *launder(reinterpret_cast<optional<T> *>(data() + offset));
+    }
+
+    template <typename T>
+    const optional<T> &slot(size_t offset) const
+    {
+        assert(offset != FrameLayout::none);
+        return *launder(reinterpret_cast<const optional<T> *>(data() + offset));
+    }
+
+    /**
+     * @brief the slot of a variable of type T, or nullptr if the variable is not in the frame
+     */
+    template <typename T>
+    const optional<T> *find(const void *variable) const
+    {
+        const size_t offset = layout.offset(variable);
+        return offset == FrameLayout::none ? nullptr : &slot<T>(offset);
+    }
+
+    /**
+     * @brief unbind every variable
+     */
+    void clear()
+    {
+        for (const auto &slot : layout.slots) {
+            slot.reset(data() + slot.offset);
+        }
+    }
+
+    /**
+     * @brief the frame that is active on this thread, if any
+     */
+    static const Frame *active()
+    {
+        return current();
+    }
+
+    // Makes a frame the active frame of this thread while it is in scope
+    class Activation
+    {
+    public:
+        explicit Activation(const Frame &frame) : previous(current())
+        {
+            current() = &frame;
+        }
+
+        Activation(const Activation &) = delete;
+        Activation &operator=(const Activation &) = delete;
+
+        ~Activation()
+        {
+            current() = previous;
+        }
+
+    private:
+        const Frame *previous;
+    };
+
+private:
+    static const Frame *&current()
+    {
+        static thread_local const Frame *frame = nullptr;
+        return frame;
+    }
+
+    byte *data()
+    {
+        return reinterpret_cast<byte *>(storage.data());
+    }
+
+    const byte *data() const
+    {
+        return reinterpret_cast<const byte *>(storage.data());
+    }
+
+    const FrameLayout &layout;
+    vector<max_align_t> storage;
+};
+
+} // namespace datalog
+
+#endif // FRAME_H
@@ -0,0 +1,354 @@
+#ifndef HASH_SET_H
+#define HASH_SET_H
+
+#include <vector>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief An unordered set stored in a flat open-addressing table, in the style of a Swiss table.
+ *
+ * Each slot has a control byte that is either empty, deleted, or holds 7 bits of the hash of the
+ * value in the slot. Probing reads the control bytes of a group of 8 slots at once, and compares
+ * values only in the slots whose control byte matches the hash of the key.
+ *
+ * @tparam T is the type of the values, which must be default constructible
+ * @tparam HASH hashes values
+ * @tparam EQUAL compares values for equality
+ */
+template <typename T, typename HASH = hash<T>, typename EQUAL = equal_to<T>>
+class HashSet
+{
+    static constexpr size_t groupSize = 8;
+    static constexpr uint8_t emptyControl = 0x80;
+    static constexpr uint8_t deletedControl = 0xFE;
+    static constexpr uint64_t lsbs = 0x0101010101010101ull;
+    static constexpr uint64_t msbs = 0x8080808080808080ull;
+
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef size_t size_type;
+
+    class const_iterator
+    {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T *pointer;
+        typedef const T &reference;
+
+        const_iterator() = default;
+        const_iterator(const HashSet *set, size_t slot) : set(set), slot(slot)
+        {
+            skip();
+        }
+
+        const T &operator*() const
+        {
+            return set->slots[slot];
+        }
+
+        const T *operator->() const
+        {
+            return &set->slots[slot];
+        }
+
+        const_iterator &operator++()
+        {
+            ++slot;
+            skip();
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return slot == other.slot and set == other.set;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return not (*this == other);
+        }
+
+    private:
+        friend class HashSet;
+
+        // advance to the next full slot
+        void skip()
+        {
+            while (slot < set->control.size() and (set->control[slot] & emptyControl)) {
+                ++slot;
+            }
+        }
+
+        const HashSet *set = nullptr;
+        size_t slot = 0;
+    };
+    typedef const_iterator iterator;
+
+    HashSet() = default;
+
+    HashSet(initializer_list<T> values)
+    {
+        for (const auto &value : values) {
+            insert(value);
+        }
+    }
+
+    const_iterator begin() const
+    {
+        return {this, 0};
+    }
+
+    const_iterator end() const
+    {
+        return {this, control.size()};
+    }
+
+    size_type size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    void clear()
+    {
+        control.clear();
+        slots.clear();
+        count = 0;
+        tombstones = 0;
+    }
+
+    const_iterator find(const T &key) const
+    {
+        if (control.empty()) {
+            return end();
+        }
+        const size_t h = hashOf(key);
+        size_t slot;
+        return findSlot(key, h, slot) ? const_iterator{this, slot} : end();
+    }
+
+    /**
+     * @brief insert a value, unless an equal value is already in the set
+     *
+     * @return the position of the value in the set, and whether it was inserted
+     */
+    pair<const_iterator, bool> insert(const T &value)
+    {
+        if ((count + tombstones + 1) * 8 > control.size() * 7) {
+            rehash(count + 1 > control.size() * 7 / 16 ? max(control.size() * 2, 2 * groupSize) : control.size());
+        }
+        const size_t h = hashOf(value);
+        size_t slot;
+        if (findSlot(value, h, slot)) {
+            return {const_iterator{this, slot}, false};
+        }
+        slot = freeSlot(h);
+        if (control[slot] == deletedControl) {
+            tombstones--;
+        }
+        control[slot] = fingerprint(h);
+        slots[slot] = value;
+        count++;
+        return {const_iterator{this, slot}, true};
+    }
+
+    /**
+     * @brief remove the value at a position, which leaves a tombstone in its slot
+     *
+     * @return the position of the next value
+     */
+    const_iterator erase(const_iterator it)
+    {
+        control[it.slot] = deletedControl;
+        slots[it.slot] = T{};
+        count--;
+        tombstones++;
+        return ++it;
+    }
+
+    /**
+     * @brief move the values of another set that are not in this set into this set. Unlike
+     * std::set::merge the other set is left empty.
+     *
+     * @param other
+     */
+    void merge(HashSet &other)
+    {
+        if (empty()) {
+            swap(*this, other);
+        } else {
+            for (const auto &value : other) {
+                insert(value);
+            }
+        }
+        other.clear();
+    }
+
+    bool operator==(const HashSet &other) const
+    {
+        if (size() != other.size()) {
+            return false;
+        }
+        for (const auto &value : *this) {
+            if (other.find(value) == other.end()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const HashSet &other) const
+    {
+        return not (*this == other);
+    }
+
+private:
+    // standard hashes of integers are the identity, so mix the bits before splitting the hash into
+    // a group and a fingerprint
+    size_t hashOf(const T &value) const
+    {
+        const uint64_t h = uint64_t{hasher(value)} * 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 32);
+    }
+
+    static uint8_t fingerprint(size_t h)
+    {
+        return h & 0x7F;
+    }
+
+    // the control bytes of the group of slots starting at a slot, in a word
+    uint64_t group(size_t slot) const
+    {
+        uint64_t word = 0;
+        for (size_t i = 0; i < groupSize; i++) {
+            word |= uint64_t{control[slot + i]} << (8 * i);
+        }
+        return word;
+    }
+
+    // the bytes of a word whose control byte equals a fingerprint (may include false positives,
+    // as values are compared anyway)
+    static uint64_t match(uint64_t word, uint8_t fingerprint)
+    {
+        const uint64_t x = word ^ (lsbs * fingerprint);
+        return (x - lsbs) & ~x & msbs;
+    }
+
+    static uint64_t matchEmpty(uint64_t word)
+    {
+        return word & ~(word << 6) & msbs;
+    }
+
+    static uint64_t matchEmptyOrDeleted(uint64_t word)
+    {
+        return word & msbs;
+    }
+
+    static size_t lowestByte(uint64_t mask)
+    {
+        size_t i = 0;
+        while (not (mask & 0x80)) {
+            mask >>= 8;
+            i++;
+        }
+        return i;
+    }
+
+    // visit groups in triangular order, which visits every group when their number is a power of two
+    template <typename F>
+    bool probe(size_t h, F f) const
+    {
+        const size_t groups = control.size() / groupSize;
+        size_t g = (h >> 7) & (groups - 1);
+        for (size_t step = 1; step <= groups; step++) {
+            if (f(g * groupSize, group(g * groupSize))) {
+                return true;
+            }
+            g = (g + step) & (groups - 1);
+        }
+        return false;
+    }
+
+    bool findSlot(const T &key, size_t h, size_t &slot) const
+    {
+        bool found = false;
+        probe(h, [this, &key, h, &slot, &found](size_t first, uint64_t word) {
+            for (uint64_t m = match(word, fingerprint(h)); m; m &= m - 1) {
+                const size_t candidate = first + lowestByte(m & -m);
+                if (equals(slots[candidate], key)) {
+                    slot = candidate;
+                    found = true;
+                    return true;
+                }
+            }
+            return matchEmpty(word) != 0;
+        });
+        return found;
+    }
+
+    size_t freeSlot(size_t h) const
+    {
+        size_t slot = 0;
+        probe(h, [&slot](size_t first, uint64_t word) {
+            const uint64_t m = matchEmptyOrDeleted(word);
+            if (m) {
+                slot = first + lowestByte(m);
+            }
+            return m != 0;
+        });
+        return slot;
+    }
+
+    void rehash(size_t capacity)
+    {
+        vector<uint8_t> oldControl(capacity, emptyControl);
+        vector<T> oldSlots(capacity);
+        swap(control, oldControl);
+        swap(slots, oldSlots);
+        count = 0;
+        tombstones = 0;
+        for (size_t slot = 0; slot < oldControl.size(); slot++) {
+            if (not (oldControl[slot] & emptyControl)) {
+                const size_t h = hashOf(oldSlots[slot]);
+                const size_t free = freeSlot(h);
+                control[free] = fingerprint(h);
+                slots[free] = move(oldSlots[slot]);
+                count++;
+            }
+        }
+    }
+
+    // the number of slots is zero or a power of two that is at least the group size
+    vector<uint8_t> control;
+    vector<T> slots;
+    size_t count = 0;
+    size_t tombstones = 0;
+    HASH hasher;
+    EQUAL equals;
+};
+
+} // namespace datalog
+
+#endif // HASH_SET_H
@@ -0,0 +1,132 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <ostream>
+#include <cstdint>
+#include <cassert>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief A string interned in a symbol table, represented by a dense 32-bit id, so that comparing,
+ * hashing and joining symbols are integer operations. Symbols are ordered by id, which is the order
+ * in which they were first interned. A default constructed symbol is none, which no string interns
+ * to and which orders after every interned symbol.
+ */
+struct Symbol
+{
+    // the id of no symbol
+    static constexpr uint32_t none = UINT32_MAX;
+
+    uint32_t id = none;
+
+    bool operator==(const Symbol &other) const { return id == other.id; }
+    bool operator!=(const Symbol &other) const { return id != other.id; }
+    bool operator<(const Symbol &other) const { return id < other.id; }
+    bool operator>(const Symbol &other) const { return id > other.id; }
+    bool operator<=(const Symbol &other) const { return id <= other.id; }
+    bool operator>=(const Symbol &other) const { return id >= other.id; }
+};
+
+/**
+ * @brief A table that interns strings as symbols: equal strings get the same symbol, and the ids
+ * of the symbols are 0, 1, 2... in the order their strings were first interned.
+ *
+ * Strings are interned when facts are loaded, not during evaluation, so the table is not
+ * synchronised.
+ *
+ * Symbols do not know their table: symbol() and printing (operator<<, and so the printing of
+ * states) use the global table. The strings of symbols interned in a table of their own are read
+ * with name().
+ */
+class SymbolTable
+{
+public:
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    /**
+     * @brief the symbol of a string, which is added to the table if it is not there
+     */
+    Symbol intern(string_view name)
+    {
+        const auto it = ids.find(name);
+        if (it != ids.end()) {
+            return {it->second};
+        }
+        assert(names.size() < Symbol::none);
+        const Symbol symbol{static_cast<uint32_t>(names.size())};
+        // the keys of ids view the strings in names, whose addresses are stable
+        names.emplace_back(name);
+        ids.emplace(names.back(), symbol.id);
+        return symbol;
+    }
+
+    /**
+     * @brief the string of a symbol of this table, which is empty for none
+     */
+    const string &name(Symbol symbol) const
+    {
+        static const string noName;
+        if (symbol.id == Symbol::none) {
+            return noName;
+        }
+        assert(symbol.id < names.size());
+        return names[symbol.id];
+    }
+
+    size_t size() const
+    {
+        return names.size();
+    }
+
+    /**
+     * @brief the table used by symbol() and for printing symbols
+     */
+    static SymbolTable &global()
+    {
+        static SymbolTable table;
+        return table;
+    }
+
+private:
+    deque<string> names;
+    unordered_map<string_view, uint32_t> ids;
+};
+
+/**
+ * @brief the symbol of a string in the global symbol table
+ */
+inline Symbol symbol(string_view name)
+{
+    return SymbolTable::global().intern(name);
+}
+
+// symbols print as their strings in the global symbol table, whichever table interned them
+inline ostream &operator<<(ostream &out, Symbol symbol)
+{
+    return out << SymbolTable::global().name(symbol);
+}
+
+} // namespace datalog
+
+namespace std
+{
+template <>
+struct hash<datalog::Symbol>
+{
+    size_t operator()(datalog::Symbol symbol) const
+    {
+        return hash<uint32_t>()(symbol.id);
+    }
+};
+} // namespace std
+
+#endif // SYMBOL_TABLE_H
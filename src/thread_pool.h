@@ -0,0 +1,225 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief A fixed set of worker threads that run batches of tasks, scheduled by work stealing. Each
+ * worker has its own queue: it runs the tasks of the batches it starts from the back of its queue,
+ * and when its queue is empty it steals from the front of the other queues, so that long tasks on
+ * one worker do not leave the others idle. Batches started by threads outside the pool are queued
+ * on a queue of their own, from which every worker steals.
+ *
+ * The thread that runs a batch also runs tasks until its batch has finished, so a pool of n workers
+ * runs n + 1 tasks at once, a pool of no workers runs batches on the calling thread, and tasks may
+ * themselves run batches.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief start a pool of workers
+     *
+     * @param workers the number of threads, besides the threads that run batches
+     */
+    explicit ThreadPool(size_t workers = max(thread::hardware_concurrency(), 1u) - 1)
+    {
+        // the last queue is for threads outside the pool
+        for (size_t i = 0; i <= workers; i++) {
+            queues.push_back(make_unique<Queue>());
+        }
+        for (size_t i = 0; i < workers; i++) {
+            threads.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        workReady.notify_all();
+        for (auto &worker : threads) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief the number of tasks that may run at once
+     */
+    size_t concurrency() const
+    {
+        return threads.size() + 1;
+    }
+
+    /**
+     * @brief run tasks concurrently, returning when all of them have finished. If tasks throw, the
+     * first exception is rethrown once the others have finished.
+     *
+     * @param tasks
+     */
+    void run(const vector<function<void()>> &tasks)
+    {
+        if (tasks.empty()) {
+            return;
+        }
+        auto batch = make_shared<Batch>();
+        batch->remaining = tasks.size();
+        const size_t own = ownQueue();
+        queued += tasks.size();
+        {
+            lock_guard<mutex> lock(queues[own]->mutex);
+            for (const auto &task : tasks) {
+                queues[own]->tasks.push_back([batch, &task]() {
+                    try {
+                        task();
+                    } catch (...) {
+                        lock_guard<mutex> lock(batch->mutex);
+                        if (not batch->error) {
+                            batch->error = current_exception();
+                        }
+                    }
+                    lock_guard<mutex> lock(batch->mutex);
+                    if (--batch->remaining == 0) {
+                        batch->finished.notify_all();
+                    }
+                });
+            }
+        }
+        {
+            // synchronise with workers that are about to sleep
+            lock_guard<mutex> lock(sleepMutex);
+        }
+        workReady.notify_all();
+        // help rather than wait idly, until there is nothing left to take
+        while (not finished(*batch) and runOne(own)) {
+        }
+        unique_lock<mutex> lock(batch->mutex);
+        batch->finished.wait(lock, [&batch]() { return batch->remaining == 0; });
+        if (batch->error) {
+            rethrow_exception(batch->error);
+        }
+    }
+
+private:
+    struct Batch
+    {
+        std::mutex mutex;
+        condition_variable finished;
+        size_t remaining = 0;
+        exception_ptr error;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        deque<function<void()>> tasks;
+    };
+
+    static bool finished(Batch &batch)
+    {
+        lock_guard<mutex> lock(batch.mutex);
+        return batch.remaining == 0;
+    }
+
+    // the pool and index of the worker that is this thread, if it is a worker
+    struct Worker
+    {
+        const ThreadPool *pool = nullptr;
+        size_t index = 0;
+    };
+
+    static Worker &currentWorker()
+    {
+        static thread_local Worker worker;
+        return worker;
+    }
+
+    // the queue of this thread: its own if it is a worker of this pool, else the shared queue
+    size_t ownQueue() const
+    {
+        const Worker &worker = currentWorker();
+        return worker.pool == this ? worker.index : threads.size();
+    }
+
+    // take a task from the back of a queue, or else from the front of another
+    bool take(size_t own, function<void()> &task)
+    {
+        {
+            auto &queue = *queues[own];
+            lock_guard<mutex> lock(queue.mutex);
+            if (not queue.tasks.empty()) {
+                task = move(queue.tasks.back());
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            auto &queue = *queues[(own + i) % queues.size()];
+            lock_guard<mutex> lock(queue.mutex);
+            if (not queue.tasks.empty()) {
+                task = move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // run a task, if there is one
+    bool runOne(size_t own)
+    {
+        function<void()> task;
+        if (not take(own, task)) {
+            return false;
+        }
+        queued--;
+        task();
+        return true;
+    }
+
+    void work(size_t index)
+    {
+        currentWorker() = {this, index};
+        for (;;) {
+            if (runOne(index)) {
+                continue;
+            }
+            unique_lock<mutex> lock(sleepMutex);
+            workReady.wait(lock, [this]() { return stopping or queued > 0; });
+            if (stopping and queued == 0) {
+                return;
+            }
+        }
+    }
+
+    vector<thread> threads;
+    // a queue per worker, and one for threads outside the pool
+    vector<unique_ptr<Queue>> queues;
+    // the number of tasks in the queues
+    atomic<size_t> queued{0};
+    mutex sleepMutex;
+    condition_variable workReady;
+    bool stopping = false;
+};
+
+} // namespace datalog
+
+#endif // THREAD_POOL_H
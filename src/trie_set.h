@@ -0,0 +1,525 @@
+#ifndef TRIE_SET_H
+#define TRIE_SET_H
+
+#include <vector>
+#include <tuple>
+#include <array>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <limits>
+#include <cstdint>
+#include <cassert>
+
+namespace datalog
+{
+using namespace std;
+
+/**
+ * @brief A set of tuples stored as a trie with one level per element of the tuple. Each level is a
+ * sorted array of nodes, and the tuples that share a prefix share the nodes of that prefix, so a
+ * prefix is stored once and tuples with a given prefix are found by descending the trie. A node
+ * knows only where its children start in the next level, as a 32-bit offset, and the last level
+ * has no offsets at all.
+ *
+ * Like FlatSet, inserts are batched: insert appends tuples to an unsorted tail, and flush sorts the
+ * tail and merges it into the trie. The set must be flushed before it is read. Tries are merged and
+ * subtracted level by level: the nodes that only one trie has are copied with their descendants in
+ * bulk, and only the nodes that both have are visited.
+ *
+ * Iterators dereference to copies of the tuples, which are read from the path to their leaf.
+ *
+ * @tparam Ts are the types of the elements of the tuples
+ */
+template <typename... Ts>
+class TrieSet
+{
+    static constexpr size_t depth = sizeof...(Ts);
+    // the offsets of children limit a level to 2^32 nodes
+    typedef uint32_t Offset;
+    // the node at each level on the path to a leaf
+    typedef array<size_t, depth> Path;
+
+public:
+    typedef tuple<Ts...> Row;
+    typedef Row value_type;
+    typedef value_type key_type;
+    typedef size_t size_type;
+
+    class const_iterator
+    {
+    public:
+        typedef random_access_iterator_tag iterator_category;
+        typedef typename TrieSet::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef value_type reference;
+
+        // holds a copy of a tuple, so that it-> works
+        struct ArrowProxy
+        {
+            value_type value;
+            const value_type *operator->() const
+            {
+                return &value;
+            }
+        };
+
+        const_iterator() = default;
+        const_iterator(const TrieSet *set, size_t leaf) : set(set), path(set->pathTo(leaf)) {}
+
+        value_type operator*() const
+        {
+            return set->getRow(path, index_sequence_for<Ts...>{});
+        }
+
+        ArrowProxy operator->() const
+        {
+            return {**this};
+        }
+
+        value_type operator[](difference_type n) const
+        {
+            return *(*this + n);
+        }
+
+        // the path to the next leaf moves on from each node whose last child it leaves
+        const_iterator &operator++()
+        {
+            path[depth - 1]++;
+            for (size_t c = depth - 1; c > 0 and path[c] == set->children[c - 1][path[c - 1] + 1]; c--) {
+                path[c - 1]++;
+            }
+            return *this;
+        }
+
+        const_iterator &operator--()
+        {
+            path[depth - 1]--;
+            for (size_t c = depth - 1; c > 0 and path[c] < set->children[c - 1][path[c - 1]]; c--) {
+                path[c - 1]--;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) { auto it = *this; ++*this; return it; }
+        const_iterator operator--(int) { auto it = *this; --*this; return it; }
+        const_iterator &operator+=(difference_type n) { path = set->pathTo(leaf() + n); return *this; }
+        const_iterator &operator-=(difference_type n) { path = set->pathTo(leaf() - n); return *this; }
+        const_iterator operator+(difference_type n) const { return {set, leaf() + n}; }
+        const_iterator operator-(difference_type n) const { return {set, leaf() - n}; }
+        difference_type operator-(const const_iterator &other) const { return difference_type(leaf()) - difference_type(other.leaf()); }
+        bool operator==(const const_iterator &other) const { return leaf() == other.leaf() and set == other.set; }
+        bool operator!=(const const_iterator &other) const { return not (*this == other); }
+        bool operator<(const const_iterator &other) const { return leaf() < other.leaf(); }
+        bool operator>(const const_iterator &other) const { return leaf() > other.leaf(); }
+        bool operator<=(const const_iterator &other) const { return leaf() <= other.leaf(); }
+        bool operator>=(const const_iterator &other) const { return leaf() >= other.leaf(); }
+
+    private:
+        size_t leaf() const
+        {
+            return path[depth - 1];
+        }
+
+        const TrieSet *set = nullptr;
+        Path path{};
+    };
+    typedef const_iterator iterator;
+
+    TrieSet()
+    {
+        clear();
+    }
+
+    TrieSet(initializer_list<value_type> values)
+    {
+        clear();
+        for (const auto &value : values) {
+            insert(value);
+        }
+        flush();
+    }
+
+    const_iterator begin() const
+    {
+        assert(flushed());
+        return {this, 0};
+    }
+
+    const_iterator end() const
+    {
+        assert(flushed());
+        return {this, leaves()};
+    }
+
+    size_type size() const
+    {
+        assert(flushed());
+        return leaves();
+    }
+
+    bool empty() const
+    {
+        return leaves() == 0 and tail.empty();
+    }
+
+    void clear()
+    {
+        apply([](auto &... level) { ((level.clear()), ...); }, levels);
+        for (auto &offsets : children) {
+            offsets.assign(1, 0);
+        }
+        tail.clear();
+    }
+
+    value_type at(size_t leaf) const
+    {
+        return getRow(pathTo(leaf), index_sequence_for<Ts...>{});
+    }
+
+    /**
+     * @brief the values of the nodes at a level, one per distinct prefix of length C + 1
+     */
+    template <size_t C>
+    const vector<typename tuple_element<C, Row>::type> &level() const
+    {
+        return get<C>(levels);
+    }
+
+    /**
+     * @brief add a tuple to the unsorted tail of the set (the set must be flushed before it is read)
+     *
+     * @param value
+     */
+    void insert(const value_type &value)
+    {
+        tail.push_back(value);
+    }
+
+    /**
+     * @brief sort the tuples inserted since the last flush into a trie, and merge it into this one
+     */
+    void flush()
+    {
+        if (flushed()) {
+            return;
+        }
+        sort(tail.begin(), tail.end());
+        tail.erase(unique(tail.begin(), tail.end()), tail.end());
+        TrieSet inserted;
+        inserted.build(tail);
+        tail.clear();
+        mergeTrie(inserted);
+    }
+
+    bool flushed() const
+    {
+        return tail.empty();
+    }
+
+    /**
+     * @brief the leaves of the tuples whose first length elements equal those of key, found by
+     * descending the trie one level per element
+     *
+     * @return the range [first, last) of leaves
+     */
+    pair<size_t, size_t> prefixRange(const Row &key, size_t length) const
+    {
+        assert(flushed());
+        pair<size_t, size_t> range{0, get<0>(levels).size()};
+        descend(range, key, length, index_sequence_for<Ts...>{});
+        return range;
+    }
+
+    /**
+     * @brief the tuples that start with a prefix, which has the first elements of a tuple in key
+     * and their number in length (such as Relation::Prefix)
+     */
+    template <typename PREFIX>
+    pair<const_iterator, const_iterator> equal_range(const PREFIX &prefix) const
+    {
+        const auto range = prefixRange(prefix.key, prefix.length);
+        return {const_iterator{this, range.first}, const_iterator{this, range.second}};
+    }
+
+    const_iterator find(const value_type &value) const
+    {
+        const auto range = prefixRange(value, depth);
+        return range.first == range.second ? end() : const_iterator{this, range.first};
+    }
+
+    /**
+     * @brief move the tuples of another set that are not in this set into this set, level by level.
+     * Unlike std::set::merge the other set is left empty.
+     *
+     * @param other
+     */
+    void merge(TrieSet &other)
+    {
+        flush();
+        other.flush();
+        if (other.empty()) {
+            return;
+        }
+        if (empty()) {
+            swap(*this, other);
+            return;
+        }
+        mergeTrie(other);
+        other.clear();
+    }
+
+    /**
+     * @brief remove the tuples of this set that are in another set, level by level
+     *
+     * @param other
+     */
+    void subtract(const TrieSet &other)
+    {
+        flush();
+        assert(other.flushed());
+        if (empty() or other.empty()) {
+            return;
+        }
+        TrieSet difference;
+        difference.open();
+        subtractNodes<0>(*this, 0, get<0>(levels).size(), other, 0, get<0>(other.levels).size(), difference);
+        difference.close();
+        if (difference.leaves() != leaves()) {
+            levels = move(difference.levels);
+            children = move(difference.children);
+        }
+    }
+
+    // a trie of sorted distinct tuples has one form
+    bool operator==(const TrieSet &other) const
+    {
+        return size() == other.size() and levels == other.levels and children == other.children;
+    }
+
+    bool operator!=(const TrieSet &other) const
+    {
+        return not (*this == other);
+    }
+
+private:
+    size_t leaves() const
+    {
+        return get<depth - 1>(levels).size();
+    }
+
+    // the path to a leaf, found by a binary search of the offsets of each level from the bottom up
+    // (the path to the end is past the last node of each level)
+    Path pathTo(size_t leaf) const
+    {
+        Path path;
+        path[depth - 1] = leaf;
+        for (size_t c = depth - 1; c > 0; c--) {
+            const auto &offsets = children[c - 1];
+            path[c - 1] = upper_bound(offsets.begin(), offsets.end(), path[c]) - offsets.begin() - 1;
+        }
+        return path;
+    }
+
+    template <size_t... Is>
+    Row getRow(const Path &path, index_sequence<Is...>) const
+    {
+        return Row{get<Is>(levels)[path[Is]]...};
+    }
+
+    // the offsets of a trie being built are not followed by the sizes of the next levels, until it
+    // is closed
+    void open()
+    {
+        clear();
+        for (auto &offsets : children) {
+            offsets.clear();
+        }
+    }
+
+    template <size_t... Is>
+    void close(index_sequence<Is...>)
+    {
+        ((children[Is].push_back(Offset(get<Is + 1>(levels).size()))), ...);
+    }
+
+    void close()
+    {
+        close(make_index_sequence<depth - 1>{});
+    }
+
+    // add a node at level C, whose children are the nodes added to level C + 1 after it
+    template <size_t C>
+    void appendNode(const typename tuple_element<C, Row>::type &value)
+    {
+        get<C>(levels).push_back(value);
+        if constexpr (C + 1 < depth) {
+            assert(get<C + 1>(levels).size() <= numeric_limits<Offset>::max());
+            children[C].push_back(Offset(get<C + 1>(levels).size()));
+        }
+    }
+
+    template <size_t C>
+    void popNode()
+    {
+        get<C>(levels).pop_back();
+        if constexpr (C + 1 < depth) {
+            children[C].pop_back();
+        }
+    }
+
+    // copy the nodes [first, last) of level C of a trie, with their descendants, in bulk
+    template <size_t C>
+    void copyNodes(const TrieSet &from, size_t first, size_t last)
+    {
+        if (first == last) {
+            return;
+        }
+        const auto &values = get<C>(from.levels);
+        get<C>(levels).insert(get<C>(levels).end(), values.begin() + first, values.begin() + last);
+        if constexpr (C + 1 < depth) {
+            const auto &offsets = from.children[C];
+            const size_t base = get<C + 1>(levels).size();
+            assert(base + offsets[last] - offsets[first] <= numeric_limits<Offset>::max());
+            for (size_t i = first; i < last; i++) {
+                children[C].push_back(Offset(base + offsets[i] - offsets[first]));
+            }
+            copyNodes<C + 1>(from, offsets[first], offsets[last]);
+        }
+    }
+
+    // merge the nodes [aFirst, aLast) of level C of one trie and [bFirst, bLast) of another
+    template <size_t C>
+    static void mergeNodes(const TrieSet &a, size_t aFirst, size_t aLast, const TrieSet &b, size_t bFirst, size_t bLast, TrieSet &merged)
+    {
+        const auto &aValues = get<C>(a.levels);
+        const auto &bValues = get<C>(b.levels);
+        while (aFirst < aLast and bFirst < bLast) {
+            // the nodes of a before the next node of b
+            const size_t aNext = lower_bound(aValues.begin() + aFirst, aValues.begin() + aLast, bValues[bFirst]) - aValues.begin();
+            merged.copyNodes<C>(a, aFirst, aNext);
+            aFirst = aNext;
+            if (aFirst == aLast) {
+                break;
+            }
+            if (bValues[bFirst] < aValues[aFirst]) {
+                merged.copyNodes<C>(b, bFirst, bFirst + 1);
+            } else {
+                merged.appendNode<C>(aValues[aFirst]);
+                if constexpr (C + 1 < depth) {
+                    mergeNodes<C + 1>(a, a.children[C][aFirst], a.children[C][aFirst + 1],
+                        b, b.children[C][bFirst], b.children[C][bFirst + 1], merged);
+                }
+                aFirst++;
+            }
+            bFirst++;
+        }
+        merged.copyNodes<C>(a, aFirst, aLast);
+        merged.copyNodes<C>(b, bFirst, bLast);
+    }
+
+    // the nodes [aFirst, aLast) of level C of one trie, less the tuples below [bFirst, bLast) of another
+    template <size_t C>
+    static void subtractNodes(const TrieSet &a, size_t aFirst, size_t aLast, const TrieSet &b, size_t bFirst, size_t bLast, TrieSet &difference)
+    {
+        const auto &aValues = get<C>(a.levels);
+        const auto &bValues = get<C>(b.levels);
+        while (aFirst < aLast and bFirst < bLast) {
+            const size_t aNext = lower_bound(aValues.begin() + aFirst, aValues.begin() + aLast, bValues[bFirst]) - aValues.begin();
+            difference.copyNodes<C>(a, aFirst, aNext);
+            aFirst = aNext;
+            if (aFirst == aLast) {
+                break;
+            }
+            if (bValues[bFirst] < aValues[aFirst]) {
+                bFirst = lower_bound(bValues.begin() + bFirst, bValues.begin() + bLast, aValues[aFirst]) - bValues.begin();
+                continue;
+            }
+            // a node of both is kept if some of its children are
+            if constexpr (C + 1 < depth) {
+                const size_t kept = get<C + 1>(difference.levels).size();
+                difference.appendNode<C>(aValues[aFirst]);
+                subtractNodes<C + 1>(a, a.children[C][aFirst], a.children[C][aFirst + 1],
+                    b, b.children[C][bFirst], b.children[C][bFirst + 1], difference);
+                if (get<C + 1>(difference.levels).size() == kept) {
+                    difference.popNode<C>();
+                }
+            }
+            aFirst++;
+            bFirst++;
+        }
+        difference.copyNodes<C>(a, aFirst, aLast);
+    }
+
+    void mergeTrie(const TrieSet &other)
+    {
+        TrieSet merged;
+        merged.open();
+        mergeNodes<0>(*this, 0, get<0>(levels).size(), other, 0, get<0>(other.levels).size(), merged);
+        merged.close();
+        levels = move(merged.levels);
+        children = move(merged.children);
+    }
+
+    // the first element where two tuples differ, or depth if they are equal
+    template <size_t... Is>
+    static size_t firstDifference(const Row &a, const Row &b, index_sequence<Is...>)
+    {
+        size_t d = depth;
+        ((d == depth and not (get<Is>(a) == get<Is>(b)) ? d = Is : d), ...);
+        return d;
+    }
+
+    // add the nodes of a tuple from a level down
+    template <size_t... Is>
+    void appendNodes(const Row &row, size_t from, index_sequence<Is...>)
+    {
+        ((Is >= from ? appendNode<Is>(get<Is>(row)) : void()), ...);
+    }
+
+    // build the trie from sorted distinct tuples
+    void build(const vector<value_type> &values)
+    {
+        open();
+        for (size_t i = 0; i < values.size(); i++) {
+            const size_t from = i ? firstDifference(values[i - 1], values[i], index_sequence_for<Ts...>{}) : 0;
+            appendNodes(values[i], from, index_sequence_for<Ts...>{});
+        }
+        close();
+    }
+
+    // narrow a range of nodes of level C to the node that equals element C of key, if C < length,
+    // and then to the children of the range
+    template <size_t C>
+    void descend(pair<size_t, size_t> &range, const Row &key, size_t length) const
+    {
+        if (C < length) {
+            const auto &values = get<C>(levels);
+            const auto last = values.begin() + range.second;
+            const auto it = std::lower_bound(values.begin() + range.first, last, get<C>(key));
+            const size_t i = it - values.begin();
+            range = it != last and not (get<C>(key) < *it) ? make_pair(i, i + 1) : make_pair(i, i);
+        }
+        if constexpr (C + 1 < depth) {
+            range = {children[C][range.first], children[C][range.second]};
+        }
+    }
+
+    template <size_t... Is>
+    void descend(pair<size_t, size_t> &range, const Row &key, size_t length, index_sequence<Is...>) const
+    {
+        ((descend<Is>(range, key, length)), ...);
+    }
+
+    tuple<vector<Ts>...> levels;
+    // the index of the first child of each node of each level but the last, in the next level,
+    // followed by the size of the next level
+    array<vector<Offset>, depth - 1> children;
+    // the tuples inserted since the last flush
+    vector<value_type> tail;
+};
+
+} // namespace datalog
+
+#endif // TRIE_SET_H
@@ -2,6 +2,8 @@
 #define VARIABLE_H
 
 #include <optional>
+#include <cstddef>
+#include "frame.h"
 
 namespace datalog
 {
@@ -9,31 +11,16 @@ using namespace std;
 
 /**
  * @brief Represents a datalog variable that is either free or bound to a value.
+ *
+ * Rules bind their variables in frames (see Frame), not in the variables themselves: a variable is
+ * bound while a frame that holds a binding of it is active on a thread, and isBound and value read
+ * that binding. Elsewhere a variable is free.
  * 
  * @tparam T is the type of the variable
  */
 template <typename T>
-struct Variable : optional<T>
+struct Variable
 {
-    /**
-     * @brief bind this variable to the supplied value (making it an unfree variable)
-     * 
-     * @param value
-     */
-    void bind(const T &value)
-    {
-        this->emplace(value);
-    }
-
-    /**
-     * @brief unbinds this variable (making it a free variable)
-     * 
-     */
-    void unbind()
-    {
-        this->reset();
-    }
-
     /**
      * @brief checks whether this variable is free or bound
      * 
@@ -42,20 +29,51 @@ struct Variable : optional<T>
      */
     bool isBound() const
     {
-        return this->has_value();
+        const auto *slot = frameSlot();
+        return slot and slot->has_value();
     }
 
     /**
-     * @brief returns the bound value (if not bound then throws an exception)
+     * @brief returns the bound value (if not bound then throws bad_optional_access)
      * 
      * @return const T& 
      */
     const T &value() const
     {
-        return this->optional<T>::value();
+        if (const auto *slot = frameSlot()) {
+            return slot->value();
+        }
+        throw bad_optional_access();
+    }
+
+private:
+    // the slot of this variable in the active frame, if it is there
+    const optional<T> *frameSlot() const
+    {
+        const Frame *frame = Frame::active();
+        return frame ? frame->find<T>(this) : nullptr;
     }
 };
 
+/**
+ * @brief A variable of a rule that is known when the rule is compiled, rather than created when the
+ * program runs. The joins of rules whose variables are placeholders are planned at compile time,
+ * and evaluating them binds no variables. Its type is that of the arguments it stands for.
+ *
+ * @tparam N distinguishes the variables of a rule
+ */
+template <size_t N>
+struct Placeholder
+{
+    static constexpr size_t index = N;
+};
+
+/**
+ * @brief the placeholder for variable N of a rule
+ */
+template <size_t N>
+constexpr Placeholder<N> _v{};
+
 } // namespace datalog
 
 #endif
\ No newline at end of file
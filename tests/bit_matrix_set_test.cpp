@@ -0,0 +1,103 @@
+#include "catch.hpp"
+#include "bit_matrix_set.h"
+
+using namespace datalog;
+
+enum Colour {red, green, blue};
+
+typedef BitMatrixSet<100, int, int> Matrix;
+typedef BitMatrixSet<100, int> Vector;
+
+bool insertFindTest()
+{
+    Matrix set;
+    bool inserted = set.insert({3, 70}).second and set.insert({1, 2}).second and not set.insert({3, 70}).second;
+    vector<pair<int, int>> facts;
+    for (const auto &fact : set) {
+        facts.push_back({get<0>(fact), get<1>(fact)});
+    }
+    // facts are in order
+    return inserted and set.size() == 2 and facts == vector<pair<int, int>>{{1, 2}, {3, 70}} and
+        set.find({1, 2}) == set.begin() and set.find({2, 1}) == set.end();
+}
+
+bool enumTest()
+{
+    BitMatrixSet<3, Colour, Colour> set{{blue, red}, {red, green}};
+    return get<0>(*set.begin()) == red and get<1>(*set.begin()) == green and set.size() == 2;
+}
+
+bool prefixTest()
+{
+    Matrix set{{1, 2}, {2, 3}, {2, 99}, {3, 0}};
+    struct Prefix {
+        tuple<int, int> key;
+        size_t length;
+    };
+    auto range = set.equal_range(Prefix{{2, 0}, 1});
+    auto all = set.equal_range(Prefix{{0, 0}, 0});
+    auto one = set.equal_range(Prefix{{2, 99}, 2});
+    return distance(range.first, range.second) == 2 and get<1>(*range.first) == 3 and
+        distance(all.first, all.second) == 4 and distance(one.first, one.second) == 1;
+}
+
+bool wordOperationsTest()
+{
+    Matrix set{{1, 2}, {1, 3}};
+    Matrix other{{1, 3}, {4, 4}};
+    Matrix intersection = set;
+    intersection.intersect(other);
+    set.merge(other);
+    bool merged = set == Matrix{{1, 2}, {1, 3}, {4, 4}} and other.empty();
+    set.subtract(Matrix{{1, 2}});
+    return merged and set == Matrix{{1, 3}, {4, 4}} and intersection == Matrix{{1, 3}};
+}
+
+bool composeTest()
+{
+    Matrix edges{{1, 2}, {2, 3}, {2, 90}};
+    Matrix paths;
+    paths.compose(edges, edges);
+    Vector reached;
+    reached.compose(Vector{{1}, {2}}, edges);
+    return paths == Matrix{{1, 3}, {1, 90}} and reached == Vector{{2}, {3}, {90}};
+}
+
+// elements outside the domain are rejected rather than written past the bits of the set, and
+// lookups of them find nothing
+bool domainTest()
+{
+    Matrix set{{1, 2}};
+    bool thrown = false;
+    try {
+        set.insert({100, 2});
+    } catch (const out_of_range &) {
+        thrown = true;
+    }
+    bool negative = false;
+    try {
+        set.insert({1, -1});
+    } catch (const out_of_range &) {
+        negative = true;
+    }
+    struct Prefix {
+        tuple<int, int> key;
+        size_t length;
+    };
+    auto outside = set.equal_range(Prefix{{200, 0}, 1});
+    auto key = set.equal_range(Prefix{{1, 100}, 2});
+    auto bound = set.equal_range(Prefix{{1, 500}, 1});
+    return thrown and negative and set.size() == 1 and set.find({1, 100}) == set.end() and
+        set.find({-3, 2}) == set.end() and outside.first == set.end() and outside.second == set.end() and
+        key.first == key.second and distance(bound.first, bound.second) == 1;
+}
+
+TEST_CASE("bit matrix set", "[bit-matrix-set]")
+{
+    REQUIRE(insertFindTest());
+    REQUIRE(enumTest());
+    REQUIRE(prefixTest());
+    REQUIRE(wordOperationsTest());
+    REQUIRE(composeTest());
+    REQUIRE(domainTest());
+}
@@ -0,0 +1,216 @@
+#include "catch.hpp"
+#include "btree_set.h"
+#include <set>
+#include <thread>
+#include <string>
+#include <memory_resource>
+
+using namespace datalog;
+
+typedef BTreeSet<int> Set;
+// small nodes, so that a few values build a deep tree
+typedef BTreeSet<pair<int, int>, less<pair<int, int>>, 32> DeepSet;
+
+bool insertFindTest()
+{
+    Set set;
+    bool inserted = set.insert(3).second and set.insert(5).second and not set.insert(3).second;
+    return inserted and set.size() == 2 and *set.find(5) == 5 and set.find(4) == set.end();
+}
+
+bool orderTest()
+{
+    // insert in a scrambled order, and compare with std::set
+    DeepSet set;
+    std::set<pair<int, int>> expected;
+    for (int i = 0; i < 5000; i++) {
+        const pair<int, int> value{(i * 7919) % 1000, i % 3};
+        set.insert(value);
+        expected.insert(value);
+    }
+    return set.size() == expected.size() and equal(set.begin(), set.end(), expected.begin(), expected.end());
+}
+
+bool boundsTest()
+{
+    DeepSet set;
+    for (int i = 0; i < 100; i++) {
+        set.insert({i / 10, i % 10});
+    }
+    auto range = set.equal_range(pair<int, int>{4, 5});
+    return *set.lower_bound(pair<int, int>{4, 10}) == pair<int, int>{5, 0} and
+        set.upper_bound(pair<int, int>{9, 9}) == set.end() and
+        distance(range.first, range.second) == 1 and *range.first == pair<int, int>{4, 5};
+}
+
+// the first elements of tuple values narrow the search of a node
+typedef tuple<unsigned, unsigned> Row;
+typedef BTreeSet<Row, less<>, 64> RowSet;
+
+// the rows that start with a value, as a key that gives its leading value
+struct FirstOf {
+    Row row;
+
+    const Row *leading() const
+    {
+        return &row;
+    }
+
+    friend bool operator<(const Row &row, const FirstOf &key)
+    {
+        return get<0>(row) < get<0>(key.row);
+    }
+
+    friend bool operator<(const FirstOf &key, const Row &row)
+    {
+        return get<0>(key.row) < get<0>(row);
+    }
+};
+
+bool leadingSearchTest()
+{
+    RowSet set;
+    std::set<Row, less<>> expected;
+    for (unsigned i = 0; i < 3000; i++) {
+        // many rows share each first element
+        const Row row{(i * 7919) % 50, i % 997};
+        set.insert(row);
+        expected.insert(row);
+    }
+    bool found = true;
+    for (unsigned a = 0; a <= 50; a++) {
+        const auto range = set.equal_range(FirstOf{{a, 0}});
+        const auto expectedRange = expected.equal_range(FirstOf{{a, 0}});
+        const auto bound = expected.lower_bound(Row{a, 500});
+        found = found and equal(range.first, range.second, expectedRange.first, expectedRange.second) and
+            (bound == expected.end() ? set.lower_bound(Row{a, 500}) == set.end() : *set.lower_bound(Row{a, 500}) == *bound) and
+            (set.find(Row{a, 500}) == set.end()) == (expected.find(Row{a, 500}) == expected.end());
+    }
+    return found and set.size() == expected.size() and equal(set.begin(), set.end(), expected.begin(), expected.end());
+}
+
+bool mergeSubtractTest()
+{
+    Set set{1, 3, 5};
+    Set other{2, 3, 4};
+    set.merge(other);
+    bool merged = set == Set{1, 2, 3, 4, 5} and other.empty();
+    set.subtract(Set{2, 4, 6});
+    Set copy = set;
+    return merged and set == Set{1, 3, 5} and copy == set;
+}
+
+bool parallelMergeSubtractTest()
+{
+    // sets large enough to be split between the tasks of a pool
+    ThreadPool pool{3};
+    Set set;
+    Set other;
+    std::set<int> expected;
+    for (int i = 0; i < 100000; i++) {
+        set.insert(i * 3);
+        other.insert(i * 5 - 7);
+        expected.insert(i * 3);
+        expected.insert(i * 5 - 7);
+    }
+    set.merge(other, pool);
+    bool merged = set.size() == expected.size() and equal(set.begin(), set.end(), expected.begin(), expected.end()) and other.empty();
+    Set odd;
+    for (int i = -7; i < 500000; i += 2) {
+        odd.insert(i);
+    }
+    set.subtract(odd, pool);
+    bool even = all_of(set.begin(), set.end(), [](int value) { return value % 2 == 0; }) and
+        size_t(count_if(expected.begin(), expected.end(), [](int value) { return value % 2 == 0; })) == set.size();
+    return merged and even and *set.begin() == -2;
+}
+
+bool concurrentInsertTest()
+{
+    DeepSet set;
+    const int threads = 4;
+    const int values = 2000;
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&set, t]() {
+            // the threads insert overlapping values
+            for (int i = 0; i < values; i++) {
+                set.insert({(i * 31 + t) % values, 0});
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    int expected = 0;
+    for (const auto &value : set) {
+        if (value.first != expected++) {
+            return false;
+        }
+    }
+    return set.size() == values and expected == values;
+}
+
+// a memory resource that counts the blocks and bytes it has outstanding
+struct CountingResource : pmr::memory_resource {
+    size_t blocks = 0;
+    size_t bytes = 0;
+
+private:
+    void *do_allocate(size_t n, size_t alignment) override
+    {
+        blocks++;
+        bytes += n;
+        return pmr::new_delete_resource()->allocate(n, alignment);
+    }
+
+    void do_deallocate(void *p, size_t n, size_t alignment) override
+    {
+        blocks--;
+        bytes -= n;
+        pmr::new_delete_resource()->deallocate(p, n, alignment);
+    }
+
+    bool do_is_equal(const pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+bool arenaTest()
+{
+    CountingResource resource;
+    bool bulk;
+    {
+        DeepSet set{&resource};
+        for (int i = 0; i < 5000; i++) {
+            set.insert({i, 0});
+        }
+        // thousands of nodes come from a few growing blocks
+        bulk = resource.blocks > 0 and resource.blocks < 20;
+        set.clear();
+        bulk = bulk and resource.blocks == 1 and set.empty();
+        set.insert({1, 1});
+    }
+    // values with destructors are destroyed before the blocks are released
+    {
+        BTreeSet<string, less<string>, 64> strings{&resource};
+        for (int i = 0; i < 1000; i++) {
+            strings.insert(string(40, 'a' + i % 26) + to_string(i));
+        }
+        bulk = bulk and strings.size() == 1000;
+    }
+    return bulk and resource.blocks == 0 and resource.bytes == 0;
+}
+
+TEST_CASE("btree set", "[btree-set]")
+{
+    REQUIRE(insertFindTest());
+    REQUIRE(orderTest());
+    REQUIRE(boundsTest());
+    REQUIRE(leadingSearchTest());
+    REQUIRE(mergeSubtractTest());
+    REQUIRE(parallelMergeSubtractTest());
+    REQUIRE(concurrentInsertTest());
+    REQUIRE(arenaTest());
+}
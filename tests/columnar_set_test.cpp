@@ -0,0 +1,63 @@
+#include "catch.hpp"
+#include "columnar_set.h"
+
+using namespace datalog;
+
+typedef ColumnarSet<int, char> Set;
+
+bool batchedInsertTest()
+{
+    Set set;
+    set.insert({2, 'b'});
+    set.insert({1, 'z'});
+    set.insert({2, 'a'});
+    set.insert({2, 'b'});
+    bool wasFlushed = set.flushed();
+    set.flush();
+    // rows are sorted and distinct
+    return !wasFlushed and set == Set{{1, 'z'}, {2, 'a'}, {2, 'b'}} and *(set.begin() + 2) == make_tuple(2, 'b');
+}
+
+bool columnsTest()
+{
+    Set set{{2, 'b'}, {1, 'a'}};
+    return set.column<0>() == vector<int>{1, 2} and set.column<1>() == vector<char>{'a', 'b'};
+}
+
+bool prefixRangeTest()
+{
+    Set set{{1, 'a'}, {2, 'a'}, {2, 'b'}, {2, 'c'}, {3, 'a'}};
+    return set.prefixRange({2, 'b'}, 1) == make_pair(size_t{1}, size_t{4}) and
+        set.prefixRange({2, 'b'}, 2) == make_pair(size_t{2}, size_t{3}) and
+        set.prefixRange({4, 'a'}, 1).first == set.prefixRange({4, 'a'}, 1).second and
+        set.find({2, 'c'}).position() == 3 and set.find({2, 'd'}) == set.end();
+}
+
+bool columnScanTest()
+{
+    Set set{{1, 'a'}, {2, 'a'}, {2, 'b'}, {3, 'a'}};
+    vector<int> matches;
+    set.forEachMatch(0, set.size(), {0, 'a'}, 2, [&matches](const Set::const_iterator &it) {
+        matches.push_back(get<0>(*it));
+    });
+    return matches == vector<int>{1, 2, 3};
+}
+
+bool mergeSubtractTest()
+{
+    Set set{{1, 'a'}, {3, 'a'}};
+    Set other{{2, 'a'}, {3, 'a'}};
+    set.merge(other);
+    bool merged = set == Set{{1, 'a'}, {2, 'a'}, {3, 'a'}} and other.empty() and set.size() == 3;
+    set.subtract(Set{{2, 'a'}});
+    return merged and set == Set{{1, 'a'}, {3, 'a'}};
+}
+
+TEST_CASE("columnar set", "[columnar-set]")
+{
+    REQUIRE(batchedInsertTest());
+    REQUIRE(columnsTest());
+    REQUIRE(prefixRangeTest());
+    REQUIRE(columnScanTest());
+    REQUIRE(mergeSubtractTest());
+}
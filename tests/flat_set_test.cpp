@@ -0,0 +1,60 @@
+#include "catch.hpp"
+#include "flat_set.h"
+
+using namespace datalog;
+
+bool batchedInsertTest()
+{
+    FlatSet<int> set;
+    for (int i : {5, 3, 5, 1, 3}) {
+        set.insert(i);
+    }
+    bool wasFlushed = set.flushed();
+    set.flush();
+    return !wasFlushed and set.flushed() and set == FlatSet<int>{1, 3, 5};
+}
+
+bool findTest()
+{
+    FlatSet<int> set{2, 4, 6};
+    return set.find(4) != set.end() and set.find(5) == set.end() and
+        set.lower_bound(3) == set.find(4) and set.upper_bound(6) == set.end();
+}
+
+bool mergeTest()
+{
+    FlatSet<int> set{1, 3, 5};
+    FlatSet<int> other{2, 3, 4};
+    set.merge(other);
+    return set == FlatSet<int>{1, 2, 3, 4, 5} and other.empty();
+}
+
+bool mergeKeepsExistingTest()
+{
+    // compare only the first element, so that equal elements can be told apart
+    struct compare {
+        bool operator()(const pair<int, int> &a, const pair<int, int> &b) const {
+            return a.first < b.first;
+        }
+    };
+    FlatSet<pair<int, int>, compare> set{{1, 0}};
+    FlatSet<pair<int, int>, compare> other{{1, 1}, {2, 1}};
+    set.merge(other);
+    return set.size() == 2 and set.begin()->second == 0;
+}
+
+bool subtractTest()
+{
+    FlatSet<int> set{1, 2, 3, 4, 5};
+    set.subtract(FlatSet<int>{0, 2, 4, 6});
+    return set == FlatSet<int>{1, 3, 5};
+}
+
+TEST_CASE("flat set", "[flat-set]")
+{
+    REQUIRE(batchedInsertTest());
+    REQUIRE(findTest());
+    REQUIRE(mergeTest());
+    REQUIRE(mergeKeepsExistingTest());
+    REQUIRE(subtractTest());
+}
@@ -0,0 +1,80 @@
+#include "catch.hpp"
+#include "variable.h"
+#include <string>
+
+using namespace datalog;
+
+bool layoutTest()
+{
+    Variable<char> a;
+    Variable<double> b;
+    Variable<string> c;
+    FrameLayout layout;
+    const size_t slotA = layout.add<char>(&a);
+    const size_t slotB = layout.add<double>(&b);
+    const size_t slotC = layout.add<string>(&c);
+    // a variable has one slot, and slots are aligned for their types
+    return layout.add<double>(&b) == slotB and layout.size() == 3 and slotA == 0 and
+        slotB % alignof(optional<double>) == 0 and slotB >= sizeof(optional<char>) and
+        slotC >= slotB + sizeof(optional<double>) and layout.offset(&c) == slotC and
+        layout.offset(nullptr) == FrameLayout::none;
+}
+
+bool bindTest()
+{
+    Variable<int> a;
+    Variable<string> b;
+    FrameLayout layout;
+    const size_t slotA = layout.add<int>(&a);
+    const size_t slotB = layout.add<string>(&b);
+    Frame frame{layout};
+    if (frame.slot<int>(slotA) or frame.slot<string>(slotB)) {
+        return false;
+    }
+    frame.slot<int>(slotA).emplace(3);
+    frame.slot<string>(slotB).emplace("three");
+    const bool bound = frame.slot<int>(slotA) == 3 and frame.slot<string>(slotB) == string("three");
+    frame.clear();
+    return bound and not frame.slot<int>(slotA) and not frame.slot<string>(slotB);
+}
+
+bool framesTest()
+{
+    // two frames of a layout bind the same variable independently
+    Variable<int> a;
+    FrameLayout layout;
+    const size_t slot = layout.add<int>(&a);
+    Frame first{layout};
+    Frame second{layout};
+    first.slot<int>(slot).emplace(1);
+    second.slot<int>(slot).emplace(2);
+    return *first.slot<int>(slot) == 1 and *second.slot<int>(slot) == 2;
+}
+
+bool activationTest()
+{
+    Variable<int> a;
+    Variable<int> b;
+    FrameLayout layout;
+    const size_t slot = layout.add<int>(&a);
+    Frame frame{layout};
+    frame.slot<int>(slot).emplace(5);
+    if (a.isBound() or Frame::active()) {
+        return false;
+    }
+    bool active;
+    {
+        const Frame::Activation activation{frame};
+        // variables of the active frame read its bindings, others are free
+        active = Frame::active() == &frame and a.isBound() and a.value() == 5 and not b.isBound();
+    }
+    return active and not a.isBound() and not Frame::active();
+}
+
+TEST_CASE("frames", "[frame]")
+{
+    REQUIRE(layoutTest());
+    REQUIRE(bindTest());
+    REQUIRE(framesTest());
+    REQUIRE(activationTest());
+}
@@ -0,0 +1,79 @@
+#include "catch.hpp"
+#include "hash_set.h"
+
+using namespace datalog;
+
+typedef HashSet<int> Set;
+
+bool insertFindTest()
+{
+    Set set;
+    bool inserted = set.insert(3).second and set.insert(5).second and not set.insert(3).second;
+    return inserted and set.size() == 2 and *set.find(5) == 5 and set.find(4) == set.end();
+}
+
+bool growTest()
+{
+    Set set;
+    for (int i = 0; i < 1000; i++) {
+        set.insert(i);
+    }
+    for (int i = 0; i < 1000; i++) {
+        if (set.find(i) == set.end()) {
+            return false;
+        }
+    }
+    size_t n = 0;
+    for (auto it = set.begin(); it != set.end(); ++it) {
+        n++;
+    }
+    return set.size() == 1000 and n == 1000 and set.find(1000) == set.end();
+}
+
+bool eraseTest()
+{
+    Set set{1, 2, 3, 4};
+    for (auto it = set.begin(); it != set.end();) {
+        if (*it % 2) {
+            it = set.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // erased slots are reused
+    for (int i = 0; i < 100; i++) {
+        set.insert(1);
+        set.erase(set.find(1));
+    }
+    return set == Set{2, 4} and set.find(1) == set.end() and set.find(3) == set.end();
+}
+
+// hash and compare only the second element, so that equal elements can be told apart
+struct hashSecond {
+    size_t operator()(const pair<size_t, int> &p) const {
+        return hash<int>()(p.second);
+    }
+};
+
+struct equalSecond {
+    bool operator()(const pair<size_t, int> &a, const pair<size_t, int> &b) const {
+        return a.second == b.second;
+    }
+};
+
+bool mergeTest()
+{
+    typedef HashSet<pair<size_t, int>, hashSecond, equalSecond> TrackedSet;
+    TrackedSet set{{0, 1}, {0, 2}};
+    TrackedSet other{{1, 2}, {1, 3}};
+    set.merge(other);
+    return set.size() == 3 and other.empty() and set.find({5, 2})->first == 0 and set.find({5, 3})->first == 1;
+}
+
+TEST_CASE("hash set", "[hash-set]")
+{
+    REQUIRE(insertFindTest());
+    REQUIRE(growTest());
+    REQUIRE(eraseTest());
+    REQUIRE(mergeTest());
+}
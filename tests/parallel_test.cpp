@@ -0,0 +1,150 @@
+#include "catch.hpp"
+#include "Datalog.h"
+#include <thread>
+
+using namespace datalog;
+
+namespace closure_relations {
+    typedef unsigned int Node;
+    struct Edge : Relation<Node, Node>{};
+    struct Path : Relation<Node, Node>{};
+    struct HashEdge : HashRelation<Node, Node>{};
+    struct HashPath : HashRelation<Node, Node>{};
+    struct ColumnarEdge : ColumnarRelation<Node, Node>{};
+    struct ColumnarPath : ColumnarRelation<Node, Node>{};
+    struct Successor : Relation<Node>{};
+    struct Predecessor : Relation<Node>{};
+    struct Between : Relation<Node>{};
+}
+
+template <typename EVALUATION>
+bool parallelRules()
+{
+    using namespace closure_relations;
+
+    const Node n = 30;
+    Edge::Set edges;
+    for (Node i = 1; i < n; i++) {
+        edges.insert({i - 1, i});
+    }
+    // rules bind their variables in frames of their own, so rules that share variables are
+    // evaluated at once
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+    auto rules = ruleset(
+        rule(atom<Path>(x, y), atom<Edge>(x, y)),
+        rule(atom<Path>(x, z), atom<Path>(x, y), atom<Edge>(y, z)),
+        rule(atom<Successor>(x), atom<Edge>(0u, x)));
+
+    ThreadPool pool{3};
+    State<Edge, Path, Successor> state{edges, {}, {}};
+    const auto sequential = fixPoint<EVALUATION>(rules, state);
+    state = fixPoint<EVALUATION>(rules, move(state), pool);
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+    return state.template getSet<Path>().size() == n * (n - 1) / 2 and
+        state.template getSet<Path>() == sequential.template getSet<Path>() and state.template getSet<Successor>() == Successor::Set{{1}};
+}
+
+// the same rules evaluated by several threads at once
+bool reentrantRules()
+{
+    using namespace closure_relations;
+
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+    auto w = var<Node>();
+    auto rules = ruleset(
+        rule(atom<Path>(x, y), atom<Edge>(x, y)),
+        rule(atom<Path>(x, z), atom<Path>(x, y), atom<Edge>(y, z)),
+        rule(atom<Successor>(w), body(atom<Edge>(x, y)), lambda(w, [&y]() { return val(y) + 100; })));
+
+    // chains of different lengths
+    vector<Node> lengths{10, 20, 30, 40};
+    vector<State<Edge, Path, Successor>> states;
+    for (Node n : lengths) {
+        Edge::Set edges;
+        for (Node i = 1; i < n; i++) {
+            edges.insert({i - 1, i});
+        }
+        states.push_back({edges, {}, {}});
+    }
+    vector<thread> threads;
+    for (auto &state : states) {
+        threads.emplace_back([&rules, &state]() { state = fixPoint<IndexedJoin>(rules, move(state)); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+    deleteVar(w);
+    for (size_t i = 0; i < lengths.size(); i++) {
+        const Node n = lengths[i];
+        const auto successors = states[i].getSet<Successor>();
+        if (states[i].getSet<Path>().size() != n * (n - 1) / 2 or successors.size() != n - 1 or
+            *successors.begin() != Successor::Ground{101} or *successors.rbegin() != Successor::Ground{n + 99}) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// rules whose outermost atoms match enough facts to be split into chunks, which are joined on the pool
+template <typename EVALUATION, typename EDGE_RELATION, typename PATH_RELATION>
+bool chunkedRules()
+{
+    using namespace closure_relations;
+
+    // a chain of n nodes, each with edges to the next three, and an edge back from the last
+    const Node n = 60;
+    typename EDGE_RELATION::Set edges;
+    for (Node i = 0; i < n; i++) {
+        for (Node j = i + 1; j < n and j <= i + 3; j++) {
+            edges.insert({i, j});
+        }
+    }
+    edges.insert({n - 1, n / 2});
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+    auto w = var<Node>();
+    auto rules = ruleset(
+        rule(atom<PATH_RELATION>(x, y), atom<EDGE_RELATION>(x, y)),
+        rule(atom<PATH_RELATION>(x, z), atom<PATH_RELATION>(x, y), atom<EDGE_RELATION>(y, z)),
+        // joined on the second argument of the edges, which is not a prefix
+        rule(atom<Predecessor>(z), atom<PATH_RELATION>(x, y), atom<EDGE_RELATION>(z, y)),
+        // nodes on a cycle
+        rule(atom<Between>(x), atom<PATH_RELATION>(x, y), atom<PATH_RELATION>(y, x)),
+        rule(atom<Successor>(w), body(atom<PATH_RELATION>(x, y), atom<EDGE_RELATION>(y, z)), lambda(w, [&z]() { return val(z) + 100; })));
+
+    ThreadPool pool{3};
+    State<EDGE_RELATION, PATH_RELATION, Predecessor, Between, Successor> state{edges, {}, {}, {}, {}};
+    const auto sequential = fixPoint<EVALUATION>(rules, state);
+    state = fixPoint<EVALUATION>(rules, move(state), pool);
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+    deleteVar(w);
+    return state.template getSet<PATH_RELATION>() == sequential.template getSet<PATH_RELATION>() and
+        state.template getSet<Predecessor>() == sequential.template getSet<Predecessor>() and
+        state.template getSet<Between>().size() == n - n / 2 and state.template getSet<Between>() == sequential.template getSet<Between>() and
+        state.template getSet<Successor>() == sequential.template getSet<Successor>();
+}
+
+TEST_CASE( "parallel-rules", "[parallel-test]" ) {
+    REQUIRE( parallelRules<NestedLoopJoin>() );
+    REQUIRE( parallelRules<IndexedJoin>() );
+    REQUIRE( parallelRules<LeapfrogJoin>() );
+    REQUIRE( reentrantRules() );
+    using namespace closure_relations;
+    REQUIRE( chunkedRules<IndexedJoin, Edge, Path>() );
+    REQUIRE( chunkedRules<HashJoin, Edge, Path>() );
+    REQUIRE( chunkedRules<NestedLoopJoin, Edge, Path>() );
+    REQUIRE( chunkedRules<IndexedJoin, HashEdge, HashPath>() );
+    REQUIRE( chunkedRules<NestedLoopJoin, ColumnarEdge, ColumnarPath>() );
+}
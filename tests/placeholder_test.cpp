@@ -0,0 +1,145 @@
+#include "catch.hpp"
+#include "Datalog.h"
+
+using namespace datalog;
+
+namespace placeholder_relations {
+    typedef unsigned int Node;
+    struct Edge : Relation<Node, Node>{};
+    struct Path : Relation<Node, Node>{};
+    struct HashEdge : HashRelation<Node, Node>{};
+    struct HashPath : HashRelation<Node, Node>{};
+    struct Loop : Relation<Node>{};
+    struct Into : Relation<Node>{};
+    struct Labelled : Relation<Node, Node, Node>{};
+    struct HashLabelled : HashRelation<Node, Node, Node>{};
+}
+
+// the plan of a join is worked out at compile time
+bool planTest()
+{
+    using namespace placeholder_relations;
+
+    auto step = rule(atom<Path>(_v<0>, _v<2>), atom<Path>(_v<0>, _v<1>), atom<Edge>(_v<1>, _v<2>));
+    typedef decltype(step)::PlanType StepPlan;
+    static_assert(StepPlan::boundPositions(0) == 0);
+    static_assert(StepPlan::boundPositions(1) == 0b01);
+    static_assert(StepPlan::source(2).atom == 1 and StepPlan::source(2).position == 1);
+    static_assert(StepPlan::head[0] == 0 and StepPlan::head[1] == 2);
+
+    // constants are bound, and a placeholder that repeats within an atom is checked
+    auto labelled = rule(atom<Loop>(_v<0>), atom<Labelled>(_v<0>, 7u, _v<0>), atom<Edge>(_v<1>, _v<0>));
+    typedef decltype(labelled)::PlanType LabelledPlan;
+    static_assert(LabelledPlan::boundPositions(0) == 0b010);
+    static_assert(LabelledPlan::repeatedPositions(0) == 0b100);
+    static_assert(LabelledPlan::boundPositions(1) == 0b10);
+    static_assert(isStaticRule<decltype(labelled)>::value);
+
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto variables = rule(atom<Path>(x, y), atom<Edge>(x, y));
+    deleteVar(x);
+    deleteVar(y);
+    return not isStaticRule<decltype(variables)>::value;
+}
+
+template <typename EVALUATION, typename EDGE_RELATION, typename PATH_RELATION>
+bool transitiveClosure()
+{
+    using namespace placeholder_relations;
+
+    // a chain of n nodes
+    const Node n = 40;
+    typename EDGE_RELATION::Set edges;
+    for (Node i = 1; i < n; i++) {
+        edges.insert({i - 1, i});
+    }
+    auto base = rule(atom<PATH_RELATION>(_v<0>, _v<1>), atom<EDGE_RELATION>(_v<0>, _v<1>));
+    auto step = rule(atom<PATH_RELATION>(_v<0>, _v<2>), atom<PATH_RELATION>(_v<0>, _v<1>), atom<EDGE_RELATION>(_v<1>, _v<2>));
+    State<EDGE_RELATION, PATH_RELATION> state{edges, {}};
+    state = fixPoint<EVALUATION>(ruleset(base, step), state);
+    return state.template getSet<PATH_RELATION>().size() == n * (n - 1) / 2;
+}
+
+// rules over placeholders and rules over variables derive the same facts
+bool sameFactsTest()
+{
+    using namespace placeholder_relations;
+
+    Edge::Set edges{{0, 1}, {1, 2}, {2, 0}, {2, 3}, {3, 3}, {4, 3}};
+    Labelled::Set labels{{0, 7, 0}, {1, 7, 2}, {3, 7, 3}, {3, 8, 3}, {4, 7, 4}};
+    auto placeholders = ruleset(
+        rule(atom<Path>(_v<0>, _v<1>), atom<Edge>(_v<0>, _v<1>)),
+        rule(atom<Path>(_v<0>, _v<2>), atom<Edge>(_v<0>, _v<1>), atom<Path>(_v<1>, _v<2>)),
+        rule(atom<Loop>(_v<0>), atom<Path>(_v<0>, _v<0>)),
+        // the edges are looked up on their second argument, which is not a prefix
+        rule(atom<Into>(_v<0>), atom<Labelled>(_v<0>, 7u, _v<0>), atom<Edge>(_v<1>, _v<0>)),
+        rule(atom<Path>(5u, _v<0>), atom<Loop>(_v<0>)));
+
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+    auto variables = ruleset(
+        rule(atom<Path>(x, y), atom<Edge>(x, y)),
+        rule(atom<Path>(x, z), atom<Edge>(x, y), atom<Path>(y, z)),
+        rule(atom<Loop>(x), atom<Path>(x, x)),
+        rule(atom<Into>(x), atom<Labelled>(x, 7u, x), atom<Edge>(y, x)),
+        rule(atom<Path>(5u, x), atom<Loop>(x)));
+
+    State<Edge, Labelled, Path, Loop, Into> state{edges, labels, {}, {}, {}};
+    const auto expected = fixPoint<IndexedJoin>(variables, state);
+    const auto derived = fixPoint<IndexedJoin>(placeholders, state);
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+    return derived.getSet<Path>() == expected.getSet<Path>() and derived.getSet<Loop>() == expected.getSet<Loop>() and
+        derived.getSet<Into>() == Into::Set{{0}, {3}} and expected.getSet<Into>() == Into::Set{{0}, {3}};
+}
+
+// the outermost atom is scanned and filtered on its constants, whether its set is ordered or hashed
+template <typename LABELLED_RELATION>
+bool filterTest()
+{
+    using namespace placeholder_relations;
+
+    typename LABELLED_RELATION::Set labels{{0, 7, 1}, {1, 7, 1}, {1, 8, 2}, {2, 7, 2}, {3, 7, 0}, {3, 8, 3}};
+    auto rules = ruleset(
+        rule(atom<Path>(_v<0>, _v<1>), atom<LABELLED_RELATION>(_v<0>, 7u, _v<1>)),
+        rule(atom<Loop>(_v<0>), atom<LABELLED_RELATION>(_v<0>, _v<1>, _v<0>)),
+        rule(atom<Into>(_v<0>), atom<LABELLED_RELATION>(3u, 8u, _v<0>)));
+    State<LABELLED_RELATION, Path, Loop, Into> state{labels, {}, {}, {}};
+    state = fixPoint<NestedLoopJoin>(rules, state);
+    return state.template getSet<Path>() == Path::Set{{0, 1}, {1, 1}, {2, 2}, {3, 0}} and
+        state.template getSet<Loop>() == Loop::Set{{1}, {2}, {3}} and state.template getSet<Into>() == Into::Set{{3}};
+}
+
+bool parallelTest()
+{
+    using namespace placeholder_relations;
+
+    const Node n = 30;
+    Edge::Set edges;
+    for (Node i = 1; i < n; i++) {
+        edges.insert({i - 1, i});
+    }
+    auto rules = ruleset(
+        rule(atom<Path>(_v<0>, _v<1>), atom<Edge>(_v<0>, _v<1>)),
+        rule(atom<Path>(_v<0>, _v<2>), atom<Path>(_v<0>, _v<1>), atom<Edge>(_v<1>, _v<2>)));
+    ThreadPool pool{3};
+    State<Edge, Path> state{edges, {}};
+    state = fixPoint<NestedLoopJoin>(rules, move(state), pool);
+    return state.getSet<Path>().size() == n * (n - 1) / 2;
+}
+
+TEST_CASE("placeholders", "[placeholder-test]")
+{
+    using namespace placeholder_relations;
+    REQUIRE(planTest());
+    REQUIRE(transitiveClosure<NestedLoopJoin, Edge, Path>());
+    REQUIRE(transitiveClosure<LeapfrogJoin, Edge, Path>());
+    REQUIRE(transitiveClosure<IndexedJoin, HashEdge, HashPath>());
+    REQUIRE(sameFactsTest());
+    REQUIRE(filterTest<Labelled>());
+    REQUIRE(filterTest<HashLabelled>());
+    REQUIRE(parallelTest());
+}
@@ -2,7 +2,17 @@
 set -e
 echo "Running tests"
 ../build/types_test
+../build/parallel_test
+../build/placeholder_test
 ../build/variable_test
-../build/tuple_binding_test
+../build/flat_set_test
+../build/columnar_set_test
+../build/hash_set_test
+../build/btree_set_test
+../build/trie_set_test
+../build/bit_matrix_set_test
+../build/symbol_table_test
+../build/thread_pool_test
+../build/frame_test
 echo "Checking for memory leaks"
 cd ../build; ctest --overwrite MemoryCheckCommandOptions="--leak-check=full --error-exitcode=1" -T memcheck
\ No newline at end of file
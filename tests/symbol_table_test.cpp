@@ -0,0 +1,61 @@
+#include "catch.hpp"
+#include "symbol_table.h"
+#include <sstream>
+#include <functional>
+#include <tuple>
+
+using namespace datalog;
+
+bool internTest()
+{
+    SymbolTable table;
+    string socrates{"Socrates"};
+    const Symbol a = table.intern("Socrates");
+    const Symbol b = table.intern("Zeus");
+    // an equal string from a different source is the same symbol
+    const Symbol c = table.intern(socrates);
+    return a == c and a != b and a < b and a.id == 0 and b.id == 1 and table.size() == 2 and
+        table.name(a) == "Socrates" and table.name(b) == "Zeus";
+}
+
+bool stableNamesTest()
+{
+    SymbolTable table;
+    const string &name = table.name(table.intern("0"));
+    for (int i = 1; i < 10000; i++) {
+        table.intern(to_string(i));
+    }
+    bool found = true;
+    for (int i = 0; i < 10000; i++) {
+        found = found and table.intern(to_string(i)).id == uint32_t(i);
+    }
+    return found and name == "0" and &name == &table.name(Symbol{0}) and table.size() == 10000;
+}
+
+bool globalTest()
+{
+    const Symbol thor = symbol("Thor");
+    ostringstream out;
+    out << thor;
+    return out.str() == "Thor" and symbol(string{"Thor"}) == thor and
+        hash<Symbol>()(thor) == hash<Symbol>()(symbol("Thor"));
+}
+
+// default constructed symbols are none, which is not the symbol of any string
+bool noneTest()
+{
+    SymbolTable table;
+    const Symbol first = table.intern("");
+    const Symbol none{};
+    const tuple<Symbol, Symbol> fact{};
+    return none.id == Symbol::none and none != first and first < none and get<0>(fact) == none and
+        table.name(none).empty() and hash<Symbol>()(none) == hash<Symbol>()(Symbol{});
+}
+
+TEST_CASE("symbol table", "[symbol-table]")
+{
+    REQUIRE(internTest());
+    REQUIRE(stableNamesTest());
+    REQUIRE(globalTest());
+    REQUIRE(noneTest());
+}
@@ -0,0 +1,102 @@
+#include "catch.hpp"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+using namespace datalog;
+
+bool runTest()
+{
+    ThreadPool pool{3};
+    vector<int> results(100);
+    vector<function<void()>> tasks;
+    for (int i = 0; i < 100; i++) {
+        tasks.push_back([&results, i]() { results[i] = i * i; });
+    }
+    pool.run(tasks);
+    for (int i = 0; i < 100; i++) {
+        if (results[i] != i * i) {
+            return false;
+        }
+    }
+    return pool.concurrency() == 4;
+}
+
+bool concurrentBatchesTest()
+{
+    // batches run from several threads share the workers
+    ThreadPool pool{2};
+    atomic<int> sum{0};
+    vector<function<void()>> tasks(50, [&sum]() { sum++; });
+    vector<thread> runners;
+    for (int i = 0; i < 4; i++) {
+        runners.emplace_back([&pool, &tasks]() { pool.run(tasks); });
+    }
+    for (auto &runner : runners) {
+        runner.join();
+    }
+    return sum == 200;
+}
+
+bool nestedBatchesTest()
+{
+    // tasks that run batches of their own help to run them rather than block a worker
+    ThreadPool pool{2};
+    atomic<int> sum{0};
+    vector<function<void()>> tasks;
+    for (int i = 0; i < 8; i++) {
+        tasks.push_back([&pool, &sum]() {
+            vector<function<void()>> inner(10, [&sum]() { sum++; });
+            pool.run(inner);
+        });
+    }
+    pool.run(tasks);
+    return sum == 80;
+}
+
+bool unevenTasksTest()
+{
+    // a long task does not hold up the short tasks queued after it
+    ThreadPool pool{3};
+    atomic<int> sum{0};
+    vector<function<void()>> tasks{[&sum]() {
+        this_thread::sleep_for(chrono::milliseconds(50));
+        sum++;
+    }};
+    for (int i = 0; i < 100; i++) {
+        tasks.push_back([&sum]() { sum++; });
+    }
+    pool.run(tasks);
+    return sum == 101;
+}
+
+bool noWorkersTest()
+{
+    ThreadPool pool{0};
+    int sum = 0;
+    pool.run({[&sum]() { sum += 1; }, [&sum]() { sum += 2; }});
+    return sum == 3 and pool.concurrency() == 1;
+}
+
+bool exceptionTest()
+{
+    ThreadPool pool{2};
+    atomic<int> finished{0};
+    try {
+        pool.run({[&finished]() { finished++; }, []() { throw runtime_error("task failed"); }, [&finished]() { finished++; }});
+    } catch (const runtime_error &) {
+        return finished == 2;
+    }
+    return false;
+}
+
+TEST_CASE("thread pool", "[thread-pool]")
+{
+    REQUIRE(runTest());
+    REQUIRE(concurrentBatchesTest());
+    REQUIRE(nestedBatchesTest());
+    REQUIRE(unevenTasksTest());
+    REQUIRE(noWorkersTest());
+    REQUIRE(exceptionTest());
+}
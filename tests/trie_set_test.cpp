@@ -0,0 +1,95 @@
+#include "catch.hpp"
+#include "trie_set.h"
+#include <set>
+
+using namespace datalog;
+
+typedef TrieSet<int, char, int> Set;
+
+bool batchedInsertTest()
+{
+    Set set;
+    set.insert({2, 'b', 1});
+    set.insert({1, 'z', 1});
+    set.insert({2, 'a', 1});
+    set.insert({2, 'b', 1});
+    bool wasFlushed = set.flushed();
+    set.flush();
+    // tuples are sorted and distinct
+    return !wasFlushed and set == Set{{1, 'z', 1}, {2, 'a', 1}, {2, 'b', 1}} and *(set.begin() + 2) == make_tuple(2, 'b', 1);
+}
+
+bool sharedPrefixTest()
+{
+    Set set{{1, 'a', 1}, {1, 'a', 2}, {1, 'b', 1}, {2, 'a', 1}};
+    // each distinct prefix is one node
+    return set.level<0>() == vector<int>{1, 2} and set.level<1>() == vector<char>{'a', 'b', 'a'} and
+        set.level<2>() == vector<int>{1, 2, 1, 1} and set.size() == 4;
+}
+
+bool prefixRangeTest()
+{
+    Set set{{1, 'a', 1}, {2, 'a', 1}, {2, 'b', 1}, {2, 'b', 2}, {3, 'a', 1}};
+    return set.prefixRange({2, 'b', 0}, 1) == make_pair(size_t{1}, size_t{4}) and
+        set.prefixRange({2, 'b', 0}, 2) == make_pair(size_t{2}, size_t{4}) and
+        set.prefixRange({2, 'c', 0}, 2).first == set.prefixRange({2, 'c', 0}, 2).second and
+        set.prefixRange({0, 'a', 0}, 0) == make_pair(size_t{0}, size_t{5}) and
+        set.find({2, 'b', 2}) == set.begin() + 3 and set.find({2, 'b', 3}) == set.end();
+}
+
+bool mergeSubtractTest()
+{
+    Set set{{1, 'a', 1}, {3, 'a', 1}};
+    Set other{{2, 'a', 1}, {3, 'a', 1}};
+    set.merge(other);
+    bool merged = set == Set{{1, 'a', 1}, {2, 'a', 1}, {3, 'a', 1}} and other.empty() and set.size() == 3;
+    set.subtract(Set{{2, 'a', 1}});
+    return merged and set == Set{{1, 'a', 1}, {3, 'a', 1}};
+}
+
+// merges and differences level by level agree with those of std::set, and iterators walk the leaves
+// in order in both directions
+bool levelsTest()
+{
+    Set set;
+    std::set<tuple<int, char, int>> expected;
+    for (int round = 0; round < 20; round++) {
+        Set delta;
+        for (int i = 0; i < 50; i++) {
+            const int n = round * 131 + i * 17;
+            const tuple<int, char, int> value{n % 7, char('a' + n % 5), n % 11};
+            delta.insert(value);
+            expected.insert(value);
+        }
+        set.merge(delta);
+        if (round % 3 == 2) {
+            Set removed;
+            for (int i = 0; i < 40; i++) {
+                const tuple<int, char, int> value{(round + i) % 7, char('a' + i % 5), i % 11};
+                removed.insert(value);
+                expected.erase(value);
+            }
+            removed.flush();
+            set.subtract(removed);
+        }
+        if (set.size() != expected.size() or not equal(set.begin(), set.end(), expected.begin(), expected.end())) {
+            return false;
+        }
+    }
+    auto it = set.end();
+    for (auto value = expected.rbegin(); value != expected.rend(); ++value) {
+        if (*--it != *value) {
+            return false;
+        }
+    }
+    return it == set.begin() and set.begin() + 10 == ++(set.begin() + 9) and *(set.begin() + 10) == set.at(10);
+}
+
+TEST_CASE("trie set", "[trie-set]")
+{
+    REQUIRE(batchedInsertTest());
+    REQUIRE(sharedPrefixTest());
+    REQUIRE(prefixRangeTest());
+    REQUIRE(mergeSubtractTest());
+    REQUIRE(levelsTest());
+}
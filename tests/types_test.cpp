@@ -1,26 +1,27 @@
 #include "catch.hpp"
 #include "Datalog.h"
+#include <sstream>
 
 using namespace datalog;
 
 bool test1()
 {
     // Relations
-    typedef const char* Name;
+    typedef Symbol Name;
     enum Kind {person, god};
     struct Thing : Relation<Name, Kind>{};
     struct Mortal : Relation<Name>{};
 
     // Extensional data
-    Name socrates{"Socrates"};
-    Name rhiannon{"Rhiannon"};
-    Name albert{"Albert"};
-    Name anna{"Anna"};
-    Name henry{"Henry"};
-    Name ian{"Ian"};
-    Name zeus{"Zeus"};
-    Name persephone{"Persephone"};
-    Name thor{"Thor"};
+    Name socrates = symbol("Socrates");
+    Name rhiannon = symbol("Rhiannon");
+    Name albert = symbol("Albert");
+    Name anna = symbol("Anna");
+    Name henry = symbol("Henry");
+    Name ian = symbol("Ian");
+    Name zeus = symbol("Zeus");
+    Name persephone = symbol("Persephone");
+    Name thor = symbol("Thor");
 
     Thing::Set things{
         {socrates, person},
@@ -51,23 +52,28 @@ bool test1()
     return true;
 }
 
-bool test2()
-{
-    // Relations
-    typedef const char* Name;
+// Relations (at namespace scope so that they are not dependent types in test2)
+namespace test2_relations {
+    typedef Symbol Name;
     struct Adviser : Relation<Name, Name>{};
     struct AcademicAncestor : Relation<Name, Name>{};
     struct QueryResult : Relation<Name>{};
+}
+
+template <typename EVALUATION>
+bool test2()
+{
+    using namespace test2_relations;
 
     // Extensional data
-    Name andrew{"Andrew Rice"};
-    Name mistral{"Mistral Contrastin"};
-    Name dominic{"Dominic Orchard"};
-    Name andy{"Andy Hopper"};
-    Name alan{"Alan Mycroft"};
-    Name rod{"Rod Burstall"};
-    Name robin{"Robin Milner"};
-    Name david{"David Wheeler"};
+    Name andrew = symbol("Andrew Rice");
+    Name mistral = symbol("Mistral Contrastin");
+    Name dominic = symbol("Dominic Orchard");
+    Name andy = symbol("Andy Hopper");
+    Name alan = symbol("Alan Mycroft");
+    Name rod = symbol("Rod Burstall");
+    Name robin = symbol("Robin Milner");
+    Name david = symbol("David Wheeler");
 
     Adviser::Set advisers{
         {andrew, mistral},
@@ -100,27 +106,36 @@ bool test2()
     State<Adviser, AcademicAncestor, QueryResult> state{advisers, {}, {}};
 
     cout << "before = " << state << endl;
-    state = fixPoint(rules, state);
+    state = fixPoint<EVALUATION>(rules, state);
     cout << "after = " << state << endl;
 
     delete x;
     delete y;
     delete z;
 
-    return true;
+    QueryResult::Set expected{{alan}, {dominic}};
+    return state.getSet<QueryResult>() == expected;
 }
 
-bool po1()
-{
+// Relations (at namespace scope so that they are not dependent types in po1)
+namespace po1_relations {
     typedef unsigned int Number;
     struct Check : Relation<Number, Number, Number, Number, Number, Number>{};
     struct In : Relation<Number, Number, Number, Number, Number, Number, Number>{};
     struct A : Relation<Number, Number>{};
+    struct TrieCheck : TrieRelation<Number, Number, Number, Number, Number, Number>{};
+    struct TrieIn : TrieRelation<Number, Number, Number, Number, Number, Number, Number>{};
+}
+
+template <typename EVALUATION, typename CHECK_RELATION = po1_relations::Check, typename IN_RELATION = po1_relations::In>
+bool po1()
+{
+    using namespace po1_relations;
 
     #include "in.txt"
     #include "check.txt"
 
-    State<Check, In, A> state{check, in, {}};
+    State<CHECK_RELATION, IN_RELATION, A> state{check, in, {}};
 
     auto a = new Variable<Number>();
     auto b = new Variable<Number>();
@@ -139,57 +154,57 @@ bool po1()
     auto anon8 = new Variable<Number>();
     
     // A(1,i) :- Check(_, b, c, d, e, f), In(_, b, c, d, e, f, i).
-    auto rule1 = rule(atom<A>(1u, i), atom<Check>(anon1, b, c, d, e, f), atom<In>(anon2, b, c, d, e, f, i));
+    auto rule1 = rule(atom<A>(1u, i), atom<CHECK_RELATION>(anon1, b, c, d, e, f), atom<IN_RELATION>(anon2, b, c, d, e, f, i));
     // A(2,i) :- Check(a, _, c, d, e, f), In(a, _, c, d, e, f, i).
-    auto rule2 = rule(atom<A>(2u, i), atom<Check>(a, anon1, c, d, e, f), atom<In>(a, anon2, c, d, e, f, i));
+    auto rule2 = rule(atom<A>(2u, i), atom<CHECK_RELATION>(a, anon1, c, d, e, f), atom<IN_RELATION>(a, anon2, c, d, e, f, i));
     // A(3,i) :- Check(a, b, _, d, e, f), In(a, b, _, d, e, f, i).
-    auto rule3 = rule(atom<A>(3u, i), atom<Check>(a, b, anon1, d, e, f), atom<In>(a, b, anon2, d, e, f, i));
+    auto rule3 = rule(atom<A>(3u, i), atom<CHECK_RELATION>(a, b, anon1, d, e, f), atom<IN_RELATION>(a, b, anon2, d, e, f, i));
     // A(4,i) :- Check(a, b, c, _, e, f), In(a, b, c, _, e, f, i).
-    auto rule4 = rule(atom<A>(4u, i), atom<Check>(a, b, c, anon1, e, f), atom<In>(a, b, c, anon2, e, f, i));
+    auto rule4 = rule(atom<A>(4u, i), atom<CHECK_RELATION>(a, b, c, anon1, e, f), atom<IN_RELATION>(a, b, c, anon2, e, f, i));
     // A(5,i) :- Check(a, b, c, d, _, f), In(a, b, c, d, _, f, i).
-    auto rule5 = rule(atom<A>(5u, i), atom<Check>(a, b, c, d, anon1, f), atom<In>(a, b, c, d, anon2, f, i));
+    auto rule5 = rule(atom<A>(5u, i), atom<CHECK_RELATION>(a, b, c, d, anon1, f), atom<IN_RELATION>(a, b, c, d, anon2, f, i));
     // A(6,i) :- Check(a, b, c, d, e, _), In(a, b, c, d, e, _, i).
-    auto rule6 = rule(atom<A>(6u, i), atom<Check>(a, b, c, d, e, anon1), atom<In>(a, b, c, d, e, anon2, i));
+    auto rule6 = rule(atom<A>(6u, i), atom<CHECK_RELATION>(a, b, c, d, e, anon1), atom<IN_RELATION>(a, b, c, d, e, anon2, i));
     // A(7, i) :- Check(_, _, c, d, e, f), In(_, _, c, d, e, f, i).
-    auto rule7 = rule(atom<A>(7u, i), atom<Check>(anon1, anon2, c, d, e, f), atom<In>(anon3, anon4, c, d, e, f, i));
+    auto rule7 = rule(atom<A>(7u, i), atom<CHECK_RELATION>(anon1, anon2, c, d, e, f), atom<IN_RELATION>(anon3, anon4, c, d, e, f, i));
     // A(8, i) :- Check(a, _, _, d, e, f), In(a, _, _, d, e, f, i).
-    auto rule8 = rule(atom<A>(8u, i), atom<Check>(a, anon1, anon2, d, e, f), atom<In>(a, anon3, anon4, d, e, f, i));
+    auto rule8 = rule(atom<A>(8u, i), atom<CHECK_RELATION>(a, anon1, anon2, d, e, f), atom<IN_RELATION>(a, anon3, anon4, d, e, f, i));
     // A(9, i) :- Check(a, b, _, _, e, f), In(a, b, _, _, e, f, i).
-    auto rule9 = rule(atom<A>(9u, i), atom<Check>(a, b, anon1, anon2, e, f), atom<In>(a, b, anon3, anon4, e, f, i));
+    auto rule9 = rule(atom<A>(9u, i), atom<CHECK_RELATION>(a, b, anon1, anon2, e, f), atom<IN_RELATION>(a, b, anon3, anon4, e, f, i));
     // A(10, i) :- Check(a, b, c, _, _, f), In(a, b, c, _, _, f, i).
-    auto rule10 = rule(atom<A>(10u, i), atom<Check>(a, b, c, anon1, anon2, f), atom<In>(a, b, c, anon3, anon4, f, i));
+    auto rule10 = rule(atom<A>(10u, i), atom<CHECK_RELATION>(a, b, c, anon1, anon2, f), atom<IN_RELATION>(a, b, c, anon3, anon4, f, i));
     // A(11, i) :- Check(a, b, c, d, _, _), In(a, b, c, d, _, _, i).
-    auto rule11 = rule(atom<A>(11u, i), atom<Check>(a, b, c, d, anon1, anon2), atom<In>(a, b, c, d, anon3, anon4, i));
+    auto rule11 = rule(atom<A>(11u, i), atom<CHECK_RELATION>(a, b, c, d, anon1, anon2), atom<IN_RELATION>(a, b, c, d, anon3, anon4, i));
     // A(12, i) :- Check(_, _, _, d, e, f), In(_, _, _, d, e, f, i).
-    auto rule12 = rule(atom<A>(12u, i), atom<Check>(anon1, anon2, anon3, d, e, f), atom<In>(anon4, anon5, anon6, d, e, f, i));
+    auto rule12 = rule(atom<A>(12u, i), atom<CHECK_RELATION>(anon1, anon2, anon3, d, e, f), atom<IN_RELATION>(anon4, anon5, anon6, d, e, f, i));
     // A(13, i) :- Check(a, _, _, _, e, f), In(a, _, _, _, e, f, i).
-    auto rule13 = rule(atom<A>(13u, i), atom<Check>(a, anon1, anon2, anon3, e, f), atom<In>(a, anon4, anon5, anon6, e, f, i));
+    auto rule13 = rule(atom<A>(13u, i), atom<CHECK_RELATION>(a, anon1, anon2, anon3, e, f), atom<IN_RELATION>(a, anon4, anon5, anon6, e, f, i));
     // A(14, i) :- Check(a, b, _, _, _, f), In(a, b, _, _, _, f, i).
-    auto rule14 = rule(atom<A>(14u, i), atom<Check>(a, b, anon1, anon2, anon3, f), atom<In>(a, b, anon4, anon5, anon6, f, i));
+    auto rule14 = rule(atom<A>(14u, i), atom<CHECK_RELATION>(a, b, anon1, anon2, anon3, f), atom<IN_RELATION>(a, b, anon4, anon5, anon6, f, i));
     // A(15, i) :- Check(a, b, c, _, _, _), In(a, b, c, _, _, _, i).
-    auto rule15 = rule(atom<A>(15u, i), atom<Check>(a, b, c, anon1, anon2, anon3), atom<In>(a, b, c, anon4, anon5, anon6, i));
+    auto rule15 = rule(atom<A>(15u, i), atom<CHECK_RELATION>(a, b, c, anon1, anon2, anon3), atom<IN_RELATION>(a, b, c, anon4, anon5, anon6, i));
     // A(16, i) :- Check(_, _, _, _, e, f), In(_, _, _, _, e, f, i).
     auto rule16 = rule(atom<A>(16u, i), 
-        atom<Check>(anon1, anon2, anon3, anon4, e, f), atom<In>(anon5, anon6, anon7, anon8, e, f, i)
+        atom<CHECK_RELATION>(anon1, anon2, anon3, anon4, e, f), atom<IN_RELATION>(anon5, anon6, anon7, anon8, e, f, i)
     );
     // A(17, i) :- Check(a, _, _, _, _, f), In(a, _, _, _, _, f, i).
-    auto rule17 = rule(atom<A>(17u, i), atom<Check>(a, anon1, anon2, anon3, anon4, f), atom<In>(a, anon5, anon6, anon7, anon8, f, i));
+    auto rule17 = rule(atom<A>(17u, i), atom<CHECK_RELATION>(a, anon1, anon2, anon3, anon4, f), atom<IN_RELATION>(a, anon5, anon6, anon7, anon8, f, i));
     // A(18, i) :- Check(a, b, _, _, _, _), In(a, b, _, _, _, _, i).
-    auto rule18 = rule(atom<A>(18u, i), atom<Check>(a, b, anon1, anon2, anon3, anon4), atom<In>(a, b, anon5, anon6, anon7, anon8, i));
+    auto rule18 = rule(atom<A>(18u, i), atom<CHECK_RELATION>(a, b, anon1, anon2, anon3, anon4), atom<IN_RELATION>(a, b, anon5, anon6, anon7, anon8, i));
     //  A(19, i) :- Check(a, b, c, d, e, f), In(a, b, c, d, e, f, i).
-    auto rule19 = rule(atom<A>(19u, i), atom<Check>(a, b, c, d, e, f), atom<In>(a, b, c, d, e, f, i));
+    auto rule19 = rule(atom<A>(19u, i), atom<CHECK_RELATION>(a, b, c, d, e, f), atom<IN_RELATION>(a, b, c, d, e, f, i));
 
     auto rules = ruleset(rule1, rule2, rule3, rule4, rule5, rule6, rule7, rule8, rule9, rule10, rule11, rule12, rule13,
         rule14, rule15, rule16, rule17, rule18, rule19);
 
     //cout << "before = " << state << endl;
-    state = fixPoint(rules, state);
+    state = fixPoint<EVALUATION>(rules, state);
 
     #include "a.txt"
 
     // TODO: FIXME
     //const auto& computedA = state.getSet<A>();
-    auto& temp = state.getTrackedSet<A>();
+    auto& temp = state.template getTrackedSet<A>();
     const auto& computedA = convert<A>(temp);
     //return convert<RELATION_TYPE>(getTrackedSet<RELATION_TYPE>());
 
@@ -219,20 +234,20 @@ bool po1()
 bool test4()
 {
     // Relations
-    typedef const char* Name;
+    typedef Symbol Name;
     typedef unsigned int Age;
     enum Gender {male, female, NA};
     enum Country {england, scotland, wales, france, germany, netherlands, spain};
     struct Person : Relation<Name, Age, Gender, Country>{};
 
     // Extensional data
-    Name sam{"Sam"};
-    Name tim{"Tim"};
-    Name rod{"Rod"};
-    Name bob{"Bob"};
-    Name jill{"Jill"};
-    Name jane{"Jane"};
-    Name sally{"Sally"};
+    Name sam = symbol("Sam");
+    Name tim = symbol("Tim");
+    Name rod = symbol("Rod");
+    Name bob = symbol("Bob");
+    Name jill = symbol("Jill");
+    Name jane = symbol("Jane");
+    Name sally = symbol("Sally");
 
     Person::Set people{
         {sam, 48u, male, scotland},
@@ -311,9 +326,406 @@ bool test4()
     return true;
 }
 
+// Relations (at namespace scope so that they are not dependent types in transitiveClosure and triangles)
+namespace closure_relations {
+    typedef unsigned int Node;
+    struct Edge : Relation<Node, Node>{};
+    struct Path : Relation<Node, Node>{};
+    struct FlatEdge : FlatRelation<Node, Node>{};
+    struct FlatPath : FlatRelation<Node, Node>{};
+    struct ColumnarEdge : ColumnarRelation<Node, Node>{};
+    struct ColumnarPath : ColumnarRelation<Node, Node>{};
+    struct HashEdge : HashRelation<Node, Node>{};
+    struct HashPath : HashRelation<Node, Node>{};
+    struct TreeEdge : TreeRelation<Node, Node>{};
+    struct TreePath : TreeRelation<Node, Node>{};
+    struct TrieEdge : TrieRelation<Node, Node>{};
+    struct TriePath : TrieRelation<Node, Node>{};
+    struct BitEdge : BitMatrixRelation<20, Node, Node>{};
+    struct BitPath : BitMatrixRelation<20, Node, Node>{};
+    // a storage policy defined outside the library
+    struct UnorderedStorage {
+        static constexpr bool ordered = false;
+        template <typename RELATION_TYPE, typename... Ts>
+        using TrackedSet = unordered_set<typename RELATION_TYPE::Ground>;
+    };
+    struct UnorderedEdge : StoredRelation<UnorderedStorage, Node, Node>{};
+    struct UnorderedPath : StoredRelation<UnorderedStorage, Node, Node>{};
+    struct Triangle : Relation<Node, Node, Node>{};
+    struct Successor : Relation<Node>{};
+    struct Predecessor : Relation<Node>{};
+    struct Between : Relation<Node>{};
+}
+
+template <typename EVALUATION, typename EDGE_RELATION = closure_relations::Edge, typename PATH_RELATION = closure_relations::Path>
+bool transitiveClosure(bool linear)
+{
+    typedef closure_relations::Node Node;
+
+    // a chain of n nodes has n(n-1)/2 paths
+    const Node n = 20;
+    typename EDGE_RELATION::Set edges;
+    for (Node i = 1; i < n; i++) {
+        edges.insert({i - 1, i});
+    }
+
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+
+    auto base = rule(atom<PATH_RELATION>(x, y), atom<EDGE_RELATION>(x, y));
+    auto linearStep = rule(atom<PATH_RELATION>(x, z), atom<EDGE_RELATION>(x, y), atom<PATH_RELATION>(y, z));
+    auto nonLinearStep = rule(atom<PATH_RELATION>(x, z), atom<PATH_RELATION>(x, y), atom<PATH_RELATION>(y, z));
+
+    State<EDGE_RELATION, PATH_RELATION> state{edges, {}};
+    if (linear) {
+        state = fixPoint<EVALUATION>(ruleset(base, linearStep), state);
+    } else {
+        state = fixPoint<EVALUATION>(ruleset(base, nonLinearStep), state);
+    }
+
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+
+    return state.template getSet<PATH_RELATION>().size() == n * (n - 1) / 2;
+}
+
+template <typename EVALUATION>
+bool triangles()
+{
+    using namespace closure_relations;
+
+    // the complete graph on n nodes, with edges from lower to higher nodes, has n(n-1)(n-2)/6 triangles
+    const Node n = 12;
+    Edge::Set edges;
+    for (Node i = 0; i < n; i++) {
+        for (Node j = i + 1; j < n; j++) {
+            edges.insert({i, j});
+        }
+    }
+
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+
+    auto triangle = rule(atom<Triangle>(x, y, z), atom<Edge>(x, y), atom<Edge>(y, z), atom<Edge>(x, z));
+    // a rule can override the strategy passed to fixPoint
+    auto rules = ruleset(evaluate<EVALUATION>(triangle));
+
+    State<Edge, Triangle> state{edges, {}};
+    state = fixPoint<CartesianJoin>(rules, state);
+
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+
+    return state.getSet<Triangle>().size() == n * (n - 1) * (n - 2) / 6;
+}
+
+template <typename EVALUATION, typename EDGE_RELATION = closure_relations::Edge>
+bool selections()
+{
+    using namespace closure_relations;
+
+    // the complete graph on n nodes, with edges from lower to higher nodes
+    const Node n = 12;
+    typename EDGE_RELATION::Set edges;
+    for (Node i = 0; i < n; i++) {
+        for (Node j = i + 1; j < n; j++) {
+            edges.insert({i, j});
+        }
+    }
+
+    auto x = var<Node>();
+    Node first = 3;
+    Node last = 7;
+
+    // constants in leading positions are range scans, others are index lookups
+    auto successor = rule(atom<Successor>(x), atom<EDGE_RELATION>(first, x));
+    auto predecessor = rule(atom<Predecessor>(x), atom<EDGE_RELATION>(x, last));
+    auto between = rule(atom<Between>(x), atom<EDGE_RELATION>(first, x), atom<EDGE_RELATION>(x, last));
+
+    State<EDGE_RELATION, Successor, Predecessor, Between> state{edges, {}, {}, {}};
+    state = fixPoint<EVALUATION>(ruleset(successor, predecessor, between), state);
+
+    deleteVar(x);
+
+    return state.template getSet<Successor>().size() == n - first - 1 and
+        state.template getSet<Predecessor>().size() == last and
+        state.template getSet<Between>() == Between::Set{{4}, {5}, {6}};
+}
+
 TEST_CASE( "toy-examples", "[types-test]" ) {
     REQUIRE( test1() );
-    REQUIRE( test2() );
-    REQUIRE( po1() );
+    REQUIRE( test2<CartesianJoin>() );
+    REQUIRE( po1<CartesianJoin>() );
     REQUIRE( test4() );
-}
\ No newline at end of file
+}
+
+TEST_CASE( "semi-naive-evaluation", "[types-test]" ) {
+    REQUIRE( transitiveClosure<CartesianJoin>(true) );
+    REQUIRE( transitiveClosure<CartesianJoin>(false) );
+    REQUIRE( transitiveClosure<IndexedJoin>(true) );
+    REQUIRE( transitiveClosure<IndexedJoin>(false) );
+}
+
+TEST_CASE( "indexed-join", "[types-test]" ) {
+    REQUIRE( test2<IndexedJoin>() );
+    REQUIRE( po1<IndexedJoin>() );
+}
+
+TEST_CASE( "leapfrog-join", "[types-test]" ) {
+    REQUIRE( test2<LeapfrogJoin>() );
+    REQUIRE( po1<LeapfrogJoin>() );
+    REQUIRE( transitiveClosure<LeapfrogJoin>(true) );
+    REQUIRE( transitiveClosure<LeapfrogJoin>(false) );
+    REQUIRE( triangles<CartesianJoin>() );
+    REQUIRE( triangles<IndexedJoin>() );
+    REQUIRE( triangles<LeapfrogJoin>() );
+}
+
+TEST_CASE( "hash-join", "[types-test]" ) {
+    REQUIRE( test2<HashJoin>() );
+    REQUIRE( po1<HashJoin>() );
+    REQUIRE( transitiveClosure<HashJoin>(true) );
+    REQUIRE( transitiveClosure<HashJoin>(false) );
+    REQUIRE( triangles<HashJoin>() );
+}
+
+TEST_CASE( "merge-join", "[types-test]" ) {
+    REQUIRE( test2<MergeJoin>() );
+    REQUIRE( po1<MergeJoin>() );
+    REQUIRE( transitiveClosure<MergeJoin>(true) );
+    REQUIRE( transitiveClosure<MergeJoin>(false) );
+    REQUIRE( triangles<MergeJoin>() );
+}
+
+TEST_CASE( "selection-push-down", "[types-test]" ) {
+    REQUIRE( selections<CartesianJoin>() );
+    REQUIRE( selections<IndexedJoin>() );
+    REQUIRE( selections<HashJoin>() );
+    REQUIRE( selections<LeapfrogJoin>() );
+    REQUIRE( selections<MergeJoin>() );
+}
+
+TEST_CASE( "nested-loop-join", "[types-test]" ) {
+    REQUIRE( test2<NestedLoopJoin>() );
+    REQUIRE( po1<NestedLoopJoin>() );
+    REQUIRE( transitiveClosure<NestedLoopJoin>(true) );
+    REQUIRE( transitiveClosure<NestedLoopJoin>(false) );
+    REQUIRE( triangles<NestedLoopJoin>() );
+    REQUIRE( selections<NestedLoopJoin>() );
+}
+
+TEST_CASE( "flat-relations", "[types-test]" ) {
+    using namespace closure_relations;
+    REQUIRE( transitiveClosure<NestedLoopJoin, FlatEdge, FlatPath>(true) );
+    REQUIRE( transitiveClosure<NestedLoopJoin, FlatEdge, FlatPath>(false) );
+    REQUIRE( transitiveClosure<CartesianJoin, FlatEdge, FlatPath>(false) );
+    REQUIRE( transitiveClosure<IndexedJoin, FlatEdge, FlatPath>(false) );
+    REQUIRE( transitiveClosure<HashJoin, FlatEdge, FlatPath>(false) );
+    REQUIRE( transitiveClosure<LeapfrogJoin, FlatEdge, FlatPath>(false) );
+    REQUIRE( transitiveClosure<MergeJoin, FlatEdge, FlatPath>(false) );
+}
+
+TEST_CASE( "columnar-relations", "[types-test]" ) {
+    using namespace closure_relations;
+    REQUIRE( transitiveClosure<NestedLoopJoin, ColumnarEdge, ColumnarPath>(true) );
+    REQUIRE( transitiveClosure<NestedLoopJoin, ColumnarEdge, ColumnarPath>(false) );
+    REQUIRE( transitiveClosure<CartesianJoin, ColumnarEdge, ColumnarPath>(false) );
+    REQUIRE( transitiveClosure<IndexedJoin, ColumnarEdge, ColumnarPath>(false) );
+    REQUIRE( transitiveClosure<HashJoin, ColumnarEdge, ColumnarPath>(false) );
+    REQUIRE( transitiveClosure<LeapfrogJoin, ColumnarEdge, ColumnarPath>(false) );
+    REQUIRE( transitiveClosure<MergeJoin, ColumnarEdge, ColumnarPath>(false) );
+    REQUIRE( selections<NestedLoopJoin, ColumnarEdge>() );
+    REQUIRE( selections<IndexedJoin, ColumnarEdge>() );
+    REQUIRE( selections<LeapfrogJoin, ColumnarEdge>() );
+}
+
+TEST_CASE( "hash-relations", "[types-test]" ) {
+    using namespace closure_relations;
+    REQUIRE( transitiveClosure<NestedLoopJoin, HashEdge, HashPath>(true) );
+    REQUIRE( transitiveClosure<NestedLoopJoin, HashEdge, HashPath>(false) );
+    REQUIRE( transitiveClosure<CartesianJoin, HashEdge, HashPath>(false) );
+    REQUIRE( transitiveClosure<IndexedJoin, HashEdge, HashPath>(false) );
+    REQUIRE( transitiveClosure<HashJoin, HashEdge, HashPath>(false) );
+    REQUIRE( transitiveClosure<LeapfrogJoin, HashEdge, HashPath>(false) );
+    REQUIRE( transitiveClosure<MergeJoin, HashEdge, HashPath>(false) );
+    REQUIRE( selections<NestedLoopJoin, HashEdge>() );
+    REQUIRE( selections<IndexedJoin, HashEdge>() );
+    REQUIRE( selections<LeapfrogJoin, HashEdge>() );
+}
+
+bool mixedStorage()
+{
+    using namespace closure_relations;
+
+    HashEdge::Set edges{{0, 1}, {1, 2}};
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+    auto base = rule(atom<FlatPath>(x, y), atom<HashEdge>(x, y));
+    auto step = rule(atom<FlatPath>(x, z), atom<ColumnarEdge>(x, y), atom<FlatPath>(y, z));
+    auto copy = rule(atom<ColumnarEdge>(x, y), atom<HashEdge>(x, y));
+    State<HashEdge, ColumnarEdge, FlatPath> state{edges, {}, {}};
+    state = fixPoint(ruleset(base, step, copy), state);
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+
+    ostringstream out;
+    out << state;
+    return state.getSet<FlatPath>() == FlatPath::Set{{0, 1}, {0, 2}, {1, 2}} and
+        out.str().find("[ 0  2 ]") != string::npos;
+}
+
+TEST_CASE( "storage-policies", "[types-test]" ) {
+    using namespace closure_relations;
+    REQUIRE( mixedStorage() );
+    REQUIRE( transitiveClosure<NestedLoopJoin, UnorderedEdge, UnorderedPath>(true) );
+    REQUIRE( transitiveClosure<IndexedJoin, UnorderedEdge, FlatPath>(false) );
+    REQUIRE( transitiveClosure<MergeJoin, UnorderedEdge, UnorderedPath>(false) );
+    REQUIRE( transitiveClosure<LeapfrogJoin, ColumnarEdge, HashPath>(true) );
+    REQUIRE( selections<IndexedJoin, UnorderedEdge>() );
+    REQUIRE( transitiveClosure<IndexedJoin, TreeEdge, TreePath>(false) );
+    REQUIRE( transitiveClosure<MergeJoin, TreeEdge, TreePath>(false) );
+    REQUIRE( selections<NestedLoopJoin, TreeEdge>() );
+}
+
+TEST_CASE( "trie-relations", "[types-test]" ) {
+    using namespace closure_relations;
+    REQUIRE( po1<NestedLoopJoin, po1_relations::TrieCheck, po1_relations::TrieIn>() );
+    REQUIRE( po1<LeapfrogJoin, po1_relations::TrieCheck, po1_relations::TrieIn>() );
+    REQUIRE( transitiveClosure<NestedLoopJoin, TrieEdge, TriePath>(true) );
+    REQUIRE( transitiveClosure<IndexedJoin, TrieEdge, TriePath>(false) );
+    REQUIRE( transitiveClosure<MergeJoin, TrieEdge, TriePath>(false) );
+    REQUIRE( selections<NestedLoopJoin, TrieEdge>() );
+    REQUIRE( selections<IndexedJoin, TrieEdge>() );
+}
+
+template <typename EVALUATION>
+bool reachability()
+{
+    using namespace closure_relations;
+
+    // nodes reachable from node 0 in a chain, by composing a unary relation with the edges
+    struct Reached : BitMatrixRelation<20, Node>{};
+    BitEdge::Set edges;
+    for (Node i = 1; i < 20; i++) {
+        edges.insert({i - 1, i});
+    }
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto source = rule(atom<Reached>(0u), atom<BitEdge>(0u, x));
+    auto step = rule(atom<Reached>(y), atom<BitEdge>(x, y), atom<Reached>(x));
+    State<BitEdge, Reached> state{edges, {}};
+    state = fixPoint<EVALUATION>(ruleset(source, step), state);
+    deleteVar(x);
+    deleteVar(y);
+    return state.template getSet<Reached>().size() == 20;
+}
+
+template <typename EVALUATION>
+bool outsideDomain()
+{
+    using namespace closure_relations;
+
+    // values bound from another relation that fall outside the domain match no edges
+    struct Start : Relation<Node>{};
+    struct Out : Relation<Node, Node>{};
+    typename Start::Set starts{{20}, {100}};
+    BitEdge::Set edges{{1, 2}, {19, 0}};
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto out = rule(atom<Out>(x, y), atom<Start>(x), atom<BitEdge>(x, y));
+    State<Start, BitEdge, Out> state{starts, edges, {}};
+    state = fixPoint<EVALUATION>(ruleset(out), state);
+    deleteVar(x);
+    deleteVar(y);
+    return state.template getSet<Out>().empty();
+}
+
+TEST_CASE( "bit-matrix-relations", "[types-test]" ) {
+    using namespace closure_relations;
+    REQUIRE( transitiveClosure<NestedLoopJoin, BitEdge, BitPath>(true) );
+    REQUIRE( transitiveClosure<NestedLoopJoin, BitEdge, BitPath>(false) );
+    REQUIRE( transitiveClosure<IndexedJoin, BitEdge, BitPath>(false) );
+    REQUIRE( transitiveClosure<LeapfrogJoin, BitEdge, BitPath>(true) );
+    REQUIRE( selections<IndexedJoin, BitEdge>() );
+    REQUIRE( selections<NestedLoopJoin, BitEdge>() );
+    REQUIRE( reachability<NestedLoopJoin>() );
+    REQUIRE( outsideDomain<NestedLoopJoin>() );
+    REQUIRE( outsideDomain<IndexedJoin>() );
+}
+
+bool symbols()
+{
+    typedef Symbol Name;
+    struct Likes : Relation<Name, Name>{};
+    struct Liked : Relation<Name>{};
+
+    // names from different sources intern to the same symbols
+    string anna{"Anna"};
+    Likes::Set likes{
+        {symbol(anna), symbol("Ian")},
+        {symbol("Henry"), symbol(string{"Ian"})},
+        {symbol(string{"Ian"}), symbol("Anna")}};
+
+    auto x = var<Name>();
+    auto y = var<Name>();
+    State<Likes, Liked> state{likes, {}};
+    state = fixPoint<HashJoin>(ruleset(rule(atom<Liked>(y), atom<Likes>(x, y))), state);
+    deleteVar(x);
+    deleteVar(y);
+
+    ostringstream out;
+    out << state;
+    return state.getSet<Liked>().size() == 2 and out.str().find(" Ian ") != string::npos;
+}
+
+TEST_CASE( "symbols", "[types-test]" ) {
+    REQUIRE( symbols() );
+}
+
+template <typename EDGE_RELATION, typename PATH_RELATION>
+bool stateViews()
+{
+    using namespace closure_relations;
+    typedef EDGE_RELATION Edge;
+    typedef PATH_RELATION Path;
+
+    typename Edge::Set edges{{0, 1}, {1, 2}, {2, 3}};
+    auto x = var<Node>();
+    auto y = var<Node>();
+    auto z = var<Node>();
+    auto rules = ruleset(
+        rule(atom<Path>(x, y), atom<Edge>(x, y)),
+        rule(atom<Path>(x, z), atom<Edge>(x, y), atom<Path>(y, z)));
+
+    // the state is moved into fixPoint and evaluated in place
+    State<Edge, Path> state{edges, {}};
+    state = fixPoint<IndexedJoin>(rules, move(state));
+    // a copy of the state is left unchanged
+    const State<Edge, Path> input{edges, {}};
+    const auto copied = fixPoint(rules, input);
+    deleteVar(x);
+    deleteVar(y);
+    deleteVar(z);
+
+    // views read the facts in place
+    const auto paths = state.template view<Path>();
+    size_t n = 0;
+    for (const auto &path : paths) {
+        n += get<0>(path) < get<1>(path);
+    }
+    return &state.template getTrackedSet<Path>() == &paths.set and paths.size() == 6 and n == 6 and
+        paths.contains({0, 3}) and not paths.contains({3, 0}) and
+        input.template view<Path>().empty() and copied.template getSet<Path>() == state.template getSet<Path>();
+}
+
+TEST_CASE( "state-views", "[types-test]" ) {
+    using namespace closure_relations;
+    REQUIRE( stateViews<Edge, Path>() );
+    REQUIRE( stateViews<ColumnarEdge, ColumnarPath>() );
+}
@@ -3,6 +3,7 @@
 
 using namespace datalog;
 
+// variables are bound in the slots of frames, and read through the active frame
 bool freeVariableTest()
 {
     Variable<int> intVar;
@@ -12,15 +13,23 @@ bool freeVariableTest()
 bool boundVariableTest()
 {
     Variable<int> intVar;
-    intVar.bind(0);
+    FrameLayout layout;
+    const size_t slot = layout.add<int>(&intVar);
+    Frame bound{layout};
+    bound.slot<int>(slot).emplace(0);
+    const Frame::Activation activation{bound};
     return intVar.isBound();
 }
 
 bool bindUnbindTest()
 {
     Variable<int> intVar;
-    intVar.bind(0);
-    intVar.unbind();
+    FrameLayout layout;
+    const size_t slot = layout.add<int>(&intVar);
+    Frame frame{layout};
+    frame.slot<int>(slot).emplace(0);
+    frame.slot<int>(slot).reset();
+    const Frame::Activation activation{frame};
     return !intVar.isBound();
 }
 
@@ -28,14 +37,18 @@ bool storesValueTest()
 {
     Variable<int> intVar;
     const int value = 100;
-    intVar.bind(value);
+    FrameLayout layout;
+    const size_t slot = layout.add<int>(&intVar);
+    Frame frame{layout};
+    frame.slot<int>(slot).emplace(value);
+    const Frame::Activation activation{frame};
     return intVar.isBound() and intVar.value() == value;
 }
 
 bool absentValueTest()
 {
     Variable<int> intVar;
-    const auto &val = intVar.value();
+    intVar.value();
     return true;
 }
 
@@ -44,6 +57,6 @@ TEST_CASE("variable binding", "[variable]")
     REQUIRE(freeVariableTest());
     REQUIRE(boundVariableTest());
     REQUIRE(bindUnbindTest());
-    REQUIRE(bindUnbindTest());
+    REQUIRE(storesValueTest());
     REQUIRE_THROWS_AS(absentValueTest(), std::bad_optional_access);
 }